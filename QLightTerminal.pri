@@ -1,10 +1,11 @@
+include($$PWD/QLightTerminalCore.pri)
+
 SOURCES += \
-    $$PWD/qlightterminal.cpp \
-    $$PWD/st.cpp
+    $$PWD/animationclock.cpp \
+    $$PWD/glyphcache.cpp \
+    $$PWD/qlightterminal.cpp
 
 HEADERS += \
-    $$PWD/qlightterminal.h \
-    $$PWD/st-utils.h \
-    $$PWD/st.h
-
-LIBS += -lutil
+    $$PWD/animationclock.h \
+    $$PWD/glyphcache.h \
+    $$PWD/qlightterminal.h
@@ -8,16 +8,17 @@ CONFIG += c++11
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(QLightTerminalCore.pri)
+
 SOURCES += \
-    qlightterminal.cpp \
-    st.cpp
+    animationclock.cpp \
+    glyphcache.cpp \
+    qlightterminal.cpp
 
 HEADERS += \
-    qlightterminal.h \
-    st-utils.h \
-    st.h
-
-LIBS += -lutil
+    animationclock.h \
+    glyphcache.h \
+    qlightterminal.h
 
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
@@ -0,0 +1,22 @@
+# Terminal core without the widget (QtCore only)
+
+SOURCES += \
+    $$PWD/iomultiplexer.cpp \
+    $$PWD/replay.cpp \
+    $$PWD/shellpool.cpp \
+    $$PWD/st.cpp \
+    $$PWD/trace.cpp \
+    $$PWD/transport.cpp
+
+HEADERS += \
+    $$PWD/iomultiplexer.h \
+    $$PWD/replay.h \
+    $$PWD/shellpool.h \
+    $$PWD/st-utils.h \
+    $$PWD/st.h \
+    $$PWD/trace.h \
+    $$PWD/transport.h
+
+INCLUDEPATH += $$PWD
+
+LIBS += -lutil
@@ -0,0 +1,74 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#include "animationclock.h"
+
+#include <QCoreApplication>
+#include <QMetaMethod>
+
+namespace {
+    AnimationClock *sharedClock = nullptr;
+}
+
+AnimationClock *AnimationClock::instance() {
+    if (!sharedClock) {
+        sharedClock = new AnimationClock();
+
+        // the timer must not outlive the application
+        qAddPostRoutine([]() {
+            delete sharedClock;
+            sharedClock = nullptr;
+        });
+    }
+    return sharedClock;
+}
+
+AnimationClock::AnimationClock() {
+    epoch.start();
+
+    timer.setSingleShot(true);
+    connect(&timer, &QTimer::timeout, this, &AnimationClock::tick);
+}
+
+bool AnimationClock::phase() const {
+    return (epoch.elapsed() / interval) % 2 == 0;
+}
+
+void AnimationClock::connectNotify(const QMetaMethod &signal) {
+    if (signal == QMetaMethod::fromSignal(&AnimationClock::s_tick)) {
+        update();
+    }
+}
+
+void AnimationClock::disconnectNotify(const QMetaMethod &signal) {
+    // an invalid method means all signals were disconnected
+    if (!signal.isValid() || signal == QMetaMethod::fromSignal(&AnimationClock::s_tick)) {
+        update();
+    }
+}
+
+void AnimationClock::update() {
+    if (!isSignalConnected(QMetaMethod::fromSignal(&AnimationClock::s_tick))) {
+        timer.stop();
+    } else if (!timer.isActive()) {
+        schedule();
+    }
+}
+
+void AnimationClock::schedule() {
+    qint64 elapsed = epoch.elapsed();
+    timer.start(interval - elapsed % interval);
+}
+
+void AnimationClock::tick() {
+    // the timer may fire a little early, the phase is the one of the nearest boundary
+    qint64 phaseIndex = (epoch.elapsed() + interval / 4) / interval;
+    emit s_tick(phaseIndex % 2 == 0);
+
+    // receivers destroyed meanwhile do not notify the disconnect
+    if (isSignalConnected(QMetaMethod::fromSignal(&AnimationClock::s_tick))) {
+        qint64 next = (phaseIndex + 1) * interval - epoch.elapsed();
+        timer.start(qMax<qint64>(1, next));
+    }
+}
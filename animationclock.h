@@ -0,0 +1,50 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#ifndef ANIMATIONCLOCK_H
+#define ANIMATIONCLOCK_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+/*
+ * Process-wide clock for the cursor and text blinking of all terminals (gui thread only)
+ * Every terminal blinks in the same phase, so all of them are woken up and repainted by a single timer. Terminals
+ * subscribe by connecting to s_tick, the timer only runs while anything is connected.
+ */
+class AnimationClock : public QObject {
+    Q_OBJECT
+public:
+    static AnimationClock *instance();
+
+    static const int interval = 750; // ms per blink phase
+
+    /*
+     * True during the on phase of the current interval, the phases alternate and are counted from the first use
+     */
+    bool phase() const;
+
+    signals:
+            void s_tick(bool on); // emitted at the start of every phase
+
+protected:
+    void connectNotify(const QMetaMethod &signal) override;
+
+    void disconnectNotify(const QMetaMethod &signal) override;
+
+private:
+    AnimationClock();
+
+    QTimer timer;
+    QElapsedTimer epoch;
+
+    void tick();
+
+    void update(); // runs the timer while there are subscribers
+
+    void schedule(); // arms the timer for the next phase boundary
+};
+
+#endif // ANIMATIONCLOCK_H
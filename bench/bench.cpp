@@ -0,0 +1,335 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+/*
+ * Benchmarks for the parser, the screen model and the renderer
+ * All workloads are generated from fixed seeds, so the numbers of two builds can be compared directly.
+ * The terminals run on a MemoryTransport, no shell (and none of its rc files) takes part.
+ *
+ * Usage: QT_QPA_PLATFORM=offscreen ./qlightterminal-bench [filter]
+ *        QT_QPA_PLATFORM=offscreen ./qlightterminal-bench --replay <recording>
+ */
+
+#include "qlightterminal.h"
+#include "st.h"
+#include "replay.h"
+#include "transport.h"
+
+#include <QApplication>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QImage>
+#include <QRandomGenerator>
+#include <QVector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+    const int benchCols = 160;
+    const int benchRows = 50;
+    const int workloadSize = 8 << 20; // bytes per parser workload
+
+    typedef struct {
+        const char *name;
+        QByteArray data;
+        qint64 cells; // printed cells, used for ns per cell
+    } Workload;
+
+    void report(const char *name, qint64 ns, qint64 bytes, qint64 cells) {
+        double seconds = ns / 1e9;
+
+        if (bytes > 0) {
+            printf("%-22s %10.2f MB/s %10.2f ns/cell %10.1f ms\n", name, bytes / seconds / (1 << 20),
+                   (double) ns / cells, ns / 1e6);
+        } else {
+            printf("%-22s %10s      %10.2f ns/cell %10.1f ms\n", name, "-", (double) ns / cells, ns / 1e6);
+        }
+        fflush(stdout);
+    }
+
+    void appendUtf8(QByteArray &out, char32_t u) {
+        out += QString::fromUcs4(&u, 1).toUtf8();
+    }
+
+    Workload denseAscii() {
+        QRandomGenerator rng(1);
+        Workload w{"dense-ascii", {}, 0};
+
+        while (w.data.size() < workloadSize) {
+            for (int i = 0; i < benchCols - 1; i++) {
+                w.data += (char) rng.bounded(0x21, 0x7f);
+            }
+            w.data += "\r\n";
+            w.cells += benchCols - 1;
+        }
+        return w;
+    }
+
+    Workload sgrColor() {
+        QRandomGenerator rng(2);
+        Workload w{"sgr-color", {}, 0};
+
+        while (w.data.size() < workloadSize) {
+            for (int i = 0; i < benchCols - 1; i++) {
+                switch (rng.bounded(3)) {
+                    case 0:
+                        w.data += "\033[" + QByteArray::number(30 + rng.bounded(8)) + ";"
+                                  + QByteArray::number(40 + rng.bounded(8)) + "m";
+                        break;
+                    case 1:
+                        w.data += "\033[1;38;5;" + QByteArray::number(rng.bounded(256)) + "m";
+                        break;
+                    default:
+                        w.data += "\033[38;2;" + QByteArray::number(rng.bounded(256)) + ";"
+                                  + QByteArray::number(rng.bounded(256)) + ";"
+                                  + QByteArray::number(rng.bounded(256)) + "m";
+                }
+                w.data += (char) rng.bounded(0x21, 0x7f);
+            }
+            w.data += "\033[0m\r\n";
+            w.cells += benchCols - 1;
+        }
+        return w;
+    }
+
+    Workload cjkEmoji() {
+        QRandomGenerator rng(3);
+        Workload w{"cjk-emoji", {}, 0};
+
+        while (w.data.size() < workloadSize) {
+            int col = 0;
+            while (col < benchCols - 2) {
+                switch (rng.bounded(3)) {
+                    case 0:
+                        appendUtf8(w.data, 0x4e00 + rng.bounded(0x5000));
+                        col += 2;
+                        break;
+                    case 1:
+                        appendUtf8(w.data, 0x1f600 + rng.bounded(0x50));
+                        col += 2;
+                        break;
+                    default:
+                        w.data += (char) rng.bounded(0x21, 0x7f);
+                        col++;
+                }
+            }
+            w.data += "\r\n";
+            w.cells += col;
+        }
+        return w;
+    }
+
+    Workload scrollRegion() {
+        QRandomGenerator rng(4);
+        Workload w{"scroll-region", {}, 0};
+
+        // a status line at the top and bottom, scrolling output in between
+        w.data += "\033[2;" + QByteArray::number(benchRows - 1) + "r";
+        while (w.data.size() < workloadSize) {
+            w.data += "\033[" + QByteArray::number(benchRows - 1) + ";1H";
+            for (int i = 0; i < benchCols / 2; i++) {
+                w.data += (char) rng.bounded(0x21, 0x7f);
+            }
+            w.data += "\n";
+            w.cells += benchCols / 2;
+
+            // insert and delete lines like an editor does
+            w.data += "\033[" + QByteArray::number(2 + rng.bounded(benchRows - 3)) + ";1H";
+            w.data += rng.bounded(2) ? "\033[3L" : "\033[3M";
+        }
+        w.data += "\033[r";
+        return w;
+    }
+
+    Workload altScreen() {
+        QRandomGenerator rng(5);
+        Workload w{"alt-screen-redraw", {}, 0};
+
+        w.data += "\033[?1049h";
+        while (w.data.size() < workloadSize) {
+            // full redraw of a TUI frame
+            w.data += "\033[H\033[2J";
+            for (int y = 1; y <= benchRows; y++) {
+                w.data += "\033[" + QByteArray::number(y) + ";1H";
+                w.data += "\033[" + QByteArray::number(y == 1 || y == benchRows ? 7 : 0) + "m";
+                for (int x = 0; x < benchCols; x++) {
+                    w.data += (char) rng.bounded(0x21, 0x7f);
+                }
+            }
+            w.cells += benchCols * benchRows;
+        }
+        w.data += "\033[0m\033[?1049l";
+        return w;
+    }
+
+    void benchParser(SimpleTerminal &st, const Workload &w) {
+        // warm up and start from a clean screen
+        st.twrite("\033c", 2, 0);
+        st.twrite(w.data.constData(), qMin<int>(w.data.size(), 64 << 10), 0);
+        st.twrite("\033c", 2, 0);
+
+        QElapsedTimer timer;
+        timer.start();
+        st.twrite(w.data.constData(), w.data.size(), 0);
+        report(w.name, timer.nsecsElapsed(), w.data.size(), w.cells);
+    }
+
+    void benchGetsel(SimpleTerminal &st) {
+        Workload w = denseAscii();
+        st.twrite("\033c", 2, 0);
+        st.twrite(w.data.constData(), w.data.size(), 0); // fills the whole history
+
+        const int iterations = 20;
+        const int lines = HISTSIZE - 1 + st.term.row;
+        qint64 bytes = 0;
+
+        // from the oldest history line to the bottom of the screen
+        st.kscrollup(HISTSIZE - 1);
+        st.selstart(0, 0, 0);
+        st.selextend(st.term.col - 1, lines - 1, SEL_REGULAR, 1);
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < iterations; i++) {
+            char *sel = st.getsel();
+            if (sel) {
+                bytes += strlen(sel);
+                free(sel);
+            }
+        }
+        report("getsel", timer.nsecsElapsed(), bytes, (qint64) iterations * st.term.col * lines);
+        st.selclear();
+        st.kscrolldown(HISTSIZE - 1);
+    }
+
+    void benchResize(SimpleTerminal &st) {
+        Workload w = sgrColor();
+        st.twrite("\033c", 2, 0);
+        st.twrite(w.data.constData(), w.data.size(), 0);
+
+        const int iterations = 500;
+        qint64 cells = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < iterations; i++) {
+            int cols = 40 + (i * 37) % 200;
+            int rows = 10 + (i * 13) % 70;
+            st.tresize(cols, rows);
+            cells += cols * rows;
+        }
+        report("tresize-storm", timer.nsecsElapsed(), 0, cells);
+        st.tresize(benchCols, benchRows);
+    }
+
+    int benchReplay(SimpleTerminal &st, const char *path) {
+        PtyReplay replay(&st);
+        if (!replay.open(path)) {
+            fprintf(stderr, "Could not open recording %s\n", path);
+            return 1;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        qint64 bytes = replay.runToEnd();
+        // a recording has no cell count, the time is reported per byte
+        report("replay", timer.nsecsElapsed(), bytes, qMax<qint64>(1, bytes));
+        return 0;
+    }
+
+    /*
+     * Exposes the core and the paint event of the widget to the benchmark
+     */
+    class BenchTerminal : public QLightTerminal {
+    public:
+        BenchTerminal() : QLightTerminal(new SimpleTerminal(new MemoryTransport())) {}
+
+        SimpleTerminal *core() { return st; }
+    };
+
+    void benchPaint(BenchTerminal &terminal, const Workload &w, const char *name) {
+        SimpleTerminal *st = terminal.core();
+        st->twrite("\033c", 2, 0);
+        st->twrite(w.data.constData(), w.data.size(), 0);
+
+        QImage image(terminal.size(), QImage::Format_ARGB32_Premultiplied);
+        const int frames = 200;
+
+        // warm up the glyph cache
+        terminal.render(&image, QPoint(), QRegion(), QWidget::DrawWindowBackground);
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < frames; i++) {
+            terminal.render(&image, QPoint(), QRegion(), QWidget::DrawWindowBackground);
+        }
+        report(name, timer.nsecsElapsed(), 0, (qint64) frames * st->term.col * st->term.row);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    QApplication app(argc, argv);
+    QByteArray filter = argc > 1 ? QByteArray(argv[1]) : QByteArray();
+
+    auto selected = [&filter](const char *name) {
+        return filter.isEmpty() || QByteArray(name).contains(filter);
+    };
+
+    printf("%-22s %15s %18s %13s\n", "benchmark", "throughput", "time per cell", "total");
+
+    SimpleTerminal st(new MemoryTransport());
+    st.tresize(benchCols, benchRows);
+
+    if (filter == "--replay") {
+        return argc > 2 ? benchReplay(st, argv[2]) : 1;
+    }
+
+    QVector<Workload (*)()> workloads{denseAscii, sgrColor, cjkEmoji, scrollRegion, altScreen};
+    for (auto make: workloads) {
+        Workload w = make();
+        if (selected(w.name)) {
+            benchParser(st, w);
+        }
+    }
+
+    if (selected("getsel")) {
+        benchGetsel(st);
+    }
+
+    if (selected("tresize-storm")) {
+        benchResize(st);
+    }
+
+    if (selected("paint")) {
+        BenchTerminal terminal;
+        terminal.QWidget::resize(1280, 800);
+        terminal.show();
+
+        // wait for the debounced resize to reach the core
+        QElapsedTimer wait;
+        wait.start();
+        while (wait.elapsed() < 1000) {
+            app.processEvents(QEventLoop::AllEvents, 50);
+        }
+
+        Workload ascii = denseAscii();
+        Workload color = sgrColor();
+        Workload cjk = cjkEmoji();
+
+        benchPaint(terminal, ascii, "paint-ascii");
+        benchPaint(terminal, color, "paint-sgr-color");
+        benchPaint(terminal, cjk, "paint-cjk-emoji");
+
+        terminal.setThreadedRendering(true);
+        benchPaint(terminal, color, "paint-sgr-threaded");
+
+        terminal.setGlyphRunRendering(false);
+        terminal.setThreadedRendering(false);
+        benchPaint(terminal, color, "paint-sgr-text-layout");
+    }
+
+    return 0;
+}
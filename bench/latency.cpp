@@ -0,0 +1,140 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+/*
+ * Keypress to paint latency harness
+ * Injects synthetic key events into the widget with cat as the child process. The tty echoes each key back,
+ * so every sample covers keyPressEvent -> ttywrite -> echo in ttyread -> finished paintEvent.
+ *
+ * Usage: QT_QPA_PLATFORM=offscreen ./qlightterminal-latency [samples]
+ */
+
+#include "qlightterminal.h"
+#include "st.h"
+#include "trace.h"
+
+#include <QApplication>
+#include <QEventLoop>
+#include <QKeyEvent>
+#include <QTimer>
+#include <QVector>
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+    /*
+     * Exposes the key handling and the end of each paint to the harness
+     */
+    class LatencyTerminal : public QLightTerminal {
+    public:
+        // the tty echoes the input, cat keeps the line open without printing a prompt
+        LatencyTerminal() : QLightTerminal(new SimpleTerminal(ShellCommand{"/bin/cat", {}, {}})) {}
+
+        uint64_t lastPaintNs = 0;
+        uint64_t sampleStart = 0;
+        QEventLoop *loop = nullptr; // quit once the echo of the current sample is painted
+
+        SimpleTerminal *core() { return st; }
+
+        void press(QKeyEvent *event) { keyPressEvent(event); }
+
+        bool echoPainted() const { return st->stats.lastReadNs > sampleStart && lastPaintNs > st->stats.lastReadNs; }
+
+    protected:
+        void paintEvent(QPaintEvent *event) override {
+            QLightTerminal::paintEvent(event);
+            lastPaintNs = Trace::now();
+
+            if (loop && echoPainted()) {
+                loop->quit();
+            }
+        }
+    };
+
+    void waitFor(int ms) {
+        QEventLoop loop;
+        QTimer::singleShot(ms, &loop, &QEventLoop::quit);
+        loop.exec();
+    }
+
+    void report(const char *stage, QVector<uint64_t> &samples) {
+        if (samples.isEmpty()) {
+            printf("%-18s no samples\n", stage);
+            return;
+        }
+
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double p) {
+            return samples[qMin<int>(samples.size() - 1, samples.size() * p)] / 1000.0;
+        };
+
+        printf("%-18s p50 %9.1f us   p99 %9.1f us   max %9.1f us\n", stage, percentile(0.5), percentile(0.99),
+               samples.last() / 1000.0);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    QApplication app(argc, argv);
+    int samples = argc > 1 ? atoi(argv[1]) : 500;
+    const int timeoutMs = 1000;
+    const int lineLength = 60;
+
+    LatencyTerminal terminal;
+    terminal.QWidget::resize(1280, 800);
+    terminal.show();
+    terminal.setStatsEnabled(true);
+
+    // wait for the debounced resize and the child to start
+    waitFor(1000);
+
+    SimpleTerminal *st = terminal.core();
+    QVector<uint64_t> write, echo, paint;
+    int timeouts = 0;
+
+    // blocks in the event loop until the echo is painted or the sample timed out
+    QEventLoop loop;
+    QTimer timeout;
+    timeout.setSingleShot(true);
+    QObject::connect(&timeout, &QTimer::timeout, &loop, &QEventLoop::quit);
+
+    for (int i = 0; i < samples; i++) {
+        // end the line now and then, cat prints it back which is not part of the measurement
+        if (i > 0 && i % lineLength == 0) {
+            QKeyEvent enter(QEvent::KeyPress, Qt::Key_Return, Qt::NoModifier, "\r");
+            terminal.press(&enter);
+            waitFor(50);
+        }
+
+        QKeyEvent key(QEvent::KeyPress, Qt::Key_A + i % 26, Qt::NoModifier, QString(QChar('a' + i % 26)));
+        uint64_t start = Trace::now();
+        terminal.sampleStart = start;
+        terminal.press(&key);
+
+        if (!terminal.echoPainted()) {
+            terminal.loop = &loop;
+            timeout.start(timeoutMs);
+            loop.exec();
+            timeout.stop();
+            terminal.loop = nullptr;
+        }
+
+        if (!terminal.echoPainted()) {
+            timeouts++;
+            continue;
+        }
+
+        write.append(st->stats.lastWriteNs - start);
+        echo.append(st->stats.lastReadNs - start);
+        paint.append(terminal.lastPaintNs - start);
+    }
+
+    printf("%d samples, %d timeouts\n", samples, timeouts);
+    report("key -> ttywrite", write);
+    report("key -> ttyread", echo);
+    report("key -> paint", paint);
+
+    return timeouts == samples ? 1 : 0;
+}
@@ -0,0 +1,14 @@
+QT       += core gui widgets
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = qlightterminal-latency
+
+# run with QT_QPA_PLATFORM=offscreen to measure without a display
+include(../QLightTerminal.pri)
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    latency.cpp
@@ -0,0 +1,93 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#include "glyphcache.h"
+
+#include <QChar>
+#include <QString>
+#include <QList>
+#include <QReadLocker>
+#include <QWriteLocker>
+
+void GlyphCache::setFonts(const QFont *variantFonts) {
+    QWriteLocker locker(&lock);
+
+    for (int i = 0; i < variants; i++) {
+        fonts[i] = QRawFont::fromFont(variantFonts[i]);
+        glyphs[i].clear();
+
+        // printable ascii is resolved up front, it makes up most of the terminal output
+        for (Rune u = 0; u < 128; u++) {
+            ascii[i][u] = u < ' ' || u == 0x7f ? 0 : resolve(i, u);
+        }
+    }
+}
+
+quint32 GlyphCache::glyph(int variant, Rune u) {
+    if (u < 128) {
+        return ascii[variant][u];
+    }
+
+    {
+        QReadLocker locker(&lock);
+        auto it = glyphs[variant].constFind(u);
+        if (it != glyphs[variant].constEnd()) {
+            return it.value();
+        }
+    }
+
+    QWriteLocker locker(&lock);
+    quint32 index = resolve(variant, u);
+    glyphs[variant].insert(u, index);
+    return index;
+}
+
+quint32 GlyphCache::resolve(int variant, Rune u) const {
+    const QRawFont &font = fonts[variant];
+
+    if (!font.isValid() || !font.supportsCharacter(u) || needsShaping(u)) {
+        return 0;
+    }
+
+    char32_t c = u;
+    QList<quint32> indexes = font.glyphIndexesForString(QString::fromUcs4(&c, 1));
+
+    return indexes.size() == 1 ? indexes[0] : 0;
+}
+
+/*
+ * Returns true for runes that can not be drawn as a single glyph of a fixed cell
+ * e.g. combining marks or scripts with contextual forms (arabic, indic, ...)
+ */
+bool GlyphCache::needsShaping(Rune u) {
+    if (u < 0x300) {
+        return false;
+    }
+
+    switch (QChar::category(char32_t(u))) {
+        case QChar::Mark_NonSpacing:
+        case QChar::Mark_SpacingCombining:
+        case QChar::Mark_Enclosing:
+            return true;
+        default:
+            break;
+    }
+
+    switch (QChar::script(char32_t(u))) {
+        case QChar::Script_Common:
+        case QChar::Script_Latin:
+        case QChar::Script_Greek:
+        case QChar::Script_Cyrillic:
+        case QChar::Script_Armenian:
+        case QChar::Script_Georgian:
+        case QChar::Script_Han:
+        case QChar::Script_Hangul:
+        case QChar::Script_Hiragana:
+        case QChar::Script_Katakana:
+        case QChar::Script_Bopomofo:
+            return false;
+        default:
+            return true;
+    }
+}
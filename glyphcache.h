@@ -0,0 +1,44 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#ifndef GLYPHCACHE_H
+#define GLYPHCACHE_H
+
+#include <QFont>
+#include <QRawFont>
+#include <QHash>
+#include <QReadWriteLock>
+
+#include "st-utils.h"
+
+/*
+ * Maps runes to glyph indices of the terminal font variants
+ * Terminal text lives on a fixed grid, so glyphs resolved here can be drawn with QPainter::drawGlyphRun
+ * at their cell positions without running Qt's text layout. Runes that are missing from the font or
+ * belong to scripts that need shaping resolve to 0 and have to be drawn as text.
+ * Lookups are thread-safe. New runes are resolved with the raw fonts of the gui thread, so the band renderer
+ * resolves them before handing lines to its threads.
+ */
+class GlyphCache {
+public:
+    static const int variants = 4;
+
+    void setFonts(const QFont *variantFonts);
+
+    quint32 glyph(int variant, Rune u);
+
+    const QRawFont *rawFonts() const { return fonts; }
+
+    static bool needsShaping(Rune u);
+
+private:
+    quint32 resolve(int variant, Rune u) const;
+
+    QRawFont fonts[variants];                   // only usable from the gui thread
+    quint32 ascii[variants][128] = {};
+    QHash<Rune, quint32> glyphs[variants];
+    QReadWriteLock lock;                        // guards glyphs
+};
+
+#endif // GLYPHCACHE_H
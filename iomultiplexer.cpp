@@ -0,0 +1,162 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#include "iomultiplexer.h"
+#include "transport.h"
+
+#include <QCoreApplication>
+
+#include <unistd.h>
+#include <errno.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+namespace {
+    std::atomic<bool> defaultEnabled{false};
+    IoMultiplexer *sharedInstance = nullptr;
+}
+
+IoMultiplexer *IoMultiplexer::instance() {
+#ifdef __linux__
+    static QMutex instanceLock;
+    QMutexLocker locker(&instanceLock);
+
+    if (!sharedInstance) {
+        sharedInstance = new IoMultiplexer();
+
+        // join the thread before the application goes away
+        qAddPostRoutine([]() {
+            sharedInstance->stop();
+        });
+    }
+    return sharedInstance;
+#else
+    return nullptr;
+#endif
+}
+
+void IoMultiplexer::setUsedByDefault(bool enabled) {
+    defaultEnabled = enabled;
+}
+
+bool IoMultiplexer::usedByDefault() {
+    return defaultEnabled.load();
+}
+
+IoMultiplexer::IoMultiplexer() {
+#ifdef __linux__
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr; // marks the wake-up descriptor
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+
+    running = true;
+    thread = QThread::create([this]() { run(); });
+    thread->setObjectName("QLightTerminal I/O");
+    thread->start();
+#endif
+}
+
+IoMultiplexer::~IoMultiplexer() {
+    stop();
+}
+
+void IoMultiplexer::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+
+#ifdef __linux__
+    uint64_t one = 1;
+    while (::write(wakeFd, &one, sizeof(one)) < 0 && errno == EINTR) {
+    }
+    thread->wait();
+    delete thread;
+    thread = nullptr;
+
+    ::close(wakeFd);
+    ::close(epollFd);
+#endif
+}
+
+void IoMultiplexer::add(FdTransport *transport) {
+#ifdef __linux__
+    QMutexLocker locker(&lock);
+    transports.insert(transport);
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = transport;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, transport->readFd, &ev);
+#endif
+}
+
+void IoMultiplexer::remove(FdTransport *transport) {
+#ifdef __linux__
+    QMutexLocker locker(&lock);
+    if (transports.remove(transport)) {
+        // fails with ENOENT if reading was paused, the descriptor is already gone then
+        ::epoll_ctl(epollFd, EPOLL_CTL_DEL, transport->readFd, nullptr);
+    }
+#endif
+}
+
+/*
+ * Pausing removes the descriptor from the epoll set, a registration without events would still report EPOLLHUP and
+ * EPOLLERR and keep the thread spinning on a hung up pty
+ */
+void IoMultiplexer::arm(FdTransport *transport, bool enabled) {
+#ifdef __linux__
+    if (!enabled) {
+        ::epoll_ctl(epollFd, EPOLL_CTL_DEL, transport->readFd, nullptr);
+        return;
+    }
+
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = transport;
+    ::epoll_ctl(epollFd, EPOLL_CTL_ADD, transport->readFd, &ev);
+#endif
+}
+
+void IoMultiplexer::setReadBudget(int bytes) {
+    budget = qMax(1024, bytes);
+}
+
+void IoMultiplexer::run() {
+#ifdef __linux__
+    const int maxEvents = 64;
+    struct epoll_event events[maxEvents];
+
+    while (running.load()) {
+        int n = ::epoll_wait(epollFd, events, maxEvents, -1);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        // every ready descriptor gets one budget per round, level triggering brings busy ones back next round
+        QMutexLocker locker(&lock);
+        int readBudget = budget.load(std::memory_order_relaxed);
+
+        for (int i = 0; i < n; i++) {
+            auto *transport = static_cast<FdTransport *>(events[i].data.ptr);
+            if (!transport || !transports.contains(transport)) {
+                continue;
+            }
+
+            // disarms the descriptor itself if its buffer is full, reading is paused or the stream ended
+            transport->fill(readBudget);
+        }
+    }
+#endif
+}
@@ -0,0 +1,66 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#ifndef IOMULTIPLEXER_H
+#define IOMULTIPLEXER_H
+
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+
+#include <atomic>
+
+class FdTransport;
+
+/*
+ * Shared I/O thread servicing the descriptors of many transports with a single epoll instance
+ * Ready descriptors are read round-robin with a fixed byte budget per wake-up, so a busy terminal cannot starve quiet
+ * ones. The bytes are buffered in the transport, which is notified once per batch on its own thread.
+ * Only available on Linux, instance() returns nullptr elsewhere.
+ */
+class IoMultiplexer {
+public:
+    static IoMultiplexer *instance(); // shared multiplexer, started on first use
+
+    /*
+     * Makes new FdTransports (and therefore new terminals) use the shared multiplexer (disabled by default)
+     */
+    static void setUsedByDefault(bool enabled);
+
+    static bool usedByDefault();
+
+    void add(FdTransport *transport);
+
+    /*
+     * Unregisters the transport, the I/O thread does not touch it anymore once this returns
+     */
+    void remove(FdTransport *transport);
+
+    void setReadBudget(int bytes); // bytes read per descriptor and wake-up (64 KiB by default)
+
+    int readBudget() const { return budget.load(std::memory_order_relaxed); }
+
+private:
+    friend class FdTransport;
+
+    IoMultiplexer();
+
+    ~IoMultiplexer();
+
+    void run();
+
+    void stop();
+
+    void arm(FdTransport *transport, bool enabled); // called with the buffer lock of the transport held
+
+    int epollFd = -1;
+    int wakeFd = -1; // eventfd to interrupt epoll_wait on shutdown
+    QThread *thread = nullptr;
+    QMutex lock;     // guards transports against removal while they are serviced
+    QSet<FdTransport *> transports;
+    std::atomic<int> budget{64 << 10};
+    std::atomic<bool> running{false};
+};
+
+#endif // IOMULTIPLEXER_H
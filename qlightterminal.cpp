@@ -3,11 +3,15 @@
  */
 
 #include "qlightterminal.h"
+#include "trace.h"
+#include "animationclock.h"
 
 #include <QByteArray>
 #include <QTextCursor>
 #include <QPainter>
 #include <QKeyEvent>
+#include <QShowEvent>
+#include <QHideEvent>
 #include <QPoint>
 #include <QLayout>
 #include <QGraphicsAnchorLayout>
@@ -15,19 +19,41 @@
 #include <QGuiApplication>
 #include <QPointF>
 #include <QFontMetricsF>
-
-QLightTerminal::QLightTerminal(QWidget *parent) : QWidget(parent), scrollbar(Qt::Orientation::Vertical),
-                                                  boxLayout(this), cursorTimer(this), selectionTimer(this),
-                                                  win{0, 0, 0, 0, 100, 10, 10, 1.25, 10, 8.42, 0, 8} {
+#include <QVector>
+#include <QList>
+#include <QGlyphRun>
+#include <QImage>
+#include <QThread>
+#include <QMutexLocker>
+#include <QVarLengthArray>
+#include <QtMath>
+#include <QScreen>
+#include <QApplication>
+
+#include <cstring>
+
+QLightTerminal::QLightTerminal(QWidget *parent) : QLightTerminal(new SimpleTerminal(), parent) {}
+
+QLightTerminal::QLightTerminal(SimpleTerminal *terminal, QWidget *parent) : QWidget(parent),
+                                                                            scrollbar(Qt::Orientation::Vertical),
+                                                                            boxLayout(this),
+                                                                            selectionTimer(this),
+                                                                            win{0, 0, 0, 0, 100, 10, 10, 1.25, 10,
+                                                                                8.42, 0, 8, 10} {
     // set up terminal
-    st = new SimpleTerminal();
+    st = terminal;
+    st->setParent(this);
 
     // setup default style
     // Note: font size is not reliable use win.charWidth for length computation
     setAttribute(Qt::WA_StyledBackground, true);
+    this->updatePalette();
     this->setFontSize(10, 500);
     this->updateStyleSheet();
 
+    // one band per core for the threaded renderer
+    renderPool.setMaxThreadCount(QThread::idealThreadCount());
+
     // set up scrollbar
     boxLayout.setSpacing(0);
     boxLayout.setContentsMargins(0, 0, 0, 0);
@@ -41,14 +67,19 @@ QLightTerminal::QLightTerminal(QWidget *parent) : QWidget(parent), scrollbar(Qt:
 
     connect(st, &SimpleTerminal::s_error, this, [this](QString error) { emit s_error("Error from st: " + error); });
     connect(st, &SimpleTerminal::s_updateView, this, &QLightTerminal::updateTerminal);
+    connect(st, &SimpleTerminal::s_bell, this, []() { QApplication::beep(); });
+
+    // do not let a runaway child outpace the painter, the unparsed output is already bounded by the time-sliced
+    // parsing and the buffer of the multiplexer
+    setBackpressure(0, 4 << 20, 100);
 
-    // set up blinking cursor
-    connect(&cursorTimer, &QTimer::timeout, this, [this]() {
-        cursorVisible = !cursorVisible;
-        // cursor position is in float units while the update is in int -> need to rerender full screen to avoid cutoffs
-        update();
-    });
-    cursorTimer.start(750);
+    // leave room for input and painting between large chunks
+    setParseBudget(0, 4000);
+
+    // the cursor blinks while the terminal has focus
+    if (hasFocus()) {
+        startBlinking();
+    }
 
     // allows for auto scrolling on selection reaching the borders
     connect(&selectionTimer, &QTimer::timeout, this, &QLightTerminal::updateSelection);
@@ -58,6 +89,24 @@ QLightTerminal::QLightTerminal(QWidget *parent) : QWidget(parent), scrollbar(Qt:
 
     // connect close event of the tty
     connect(st, &SimpleTerminal::s_closed, this, &QLightTerminal::close);
+
+    // fast forward ends once the output settles, meanwhile only the progress is painted
+    settleTimer.setSingleShot(true);
+    connect(&settleTimer, &QTimer::timeout, this, [this]() { setFastForward(false); });
+    connect(&progressTimer, &QTimer::timeout, this, [this]() { scheduleFrame(progressRect()); });
+
+    // periodic statistics, see setStatsEnabled
+    connect(&statsTimer, &QTimer::timeout, this, &QLightTerminal::updateStats);
+
+    // render at most one frame per refresh interval
+    frameTimer.setSingleShot(true);
+    frameTimer.setTimerType(Qt::PreciseTimer);
+    connect(&frameTimer, &QTimer::timeout, this, &QLightTerminal::presentFrame);
+
+    // render the lines around the view port once the event loop is idle
+    prefetchTimer.setSingleShot(true);
+    prefetchTimer.setInterval(0);
+    connect(&prefetchTimer, &QTimer::timeout, this, &QLightTerminal::prefetchScrollCache);
 }
 
 void QLightTerminal::close() {
@@ -66,274 +115,1016 @@ void QLightTerminal::close() {
 
     scrollbar.setVisible(false);
 
-    cursorTimer.stop();
+    stopBlinking();
     selectionTimer.stop();
-    update();
+    scheduleFrame();
 
     emit s_closed();
 }
 
 void QLightTerminal::updateTerminal(Term *term) {
-    cursorVisible = true;
-    cursorTimer.start(750);
+    TraceScope trace("updateTerminal");
+
+    if (!fastForward && fastForwardThreshold > 0) {
+        // input rate over windows of 100 ms
+        if (!rateClock.isValid()) {
+            rateClock.start();
+            rateBytes = st->stats.bytesRead;
+        } else if (rateClock.elapsed() >= 100) {
+            double rate = (st->stats.bytesRead - rateBytes) * 1000.0 / rateClock.restart();
+            rateBytes = st->stats.bytesRead;
+
+            if (rate > fastForwardThreshold) {
+                setFastForward(true);
+            }
+        }
+    }
+
+    if (hidden) {
+        st->markPainted();
+        return;
+    }
+
+    // presents the damage held back during a synchronized update
+    scheduleFrame(QRegion());
+
+    if (fastForward) {
+        // nothing is painted, so nothing may hold the parser back
+        settleTimer.start(settleInterval);
+        st->markPainted();
+        return;
+    }
+
+    // the view shows the same history lines as before, tscrollup only moved term.scr along
+    int rows = MIN(win.viewPortHeight, st->term.row);
+    int anchor = (st->term.histi - st->term.scr + HISTSIZE) % HISTSIZE;
+    int pushed = (st->term.histi - viewHisti + HISTSIZE) % HISTSIZE;
+    bool unchanged = st->term.scr >= rows + (scrollOffset > 0 ? 1 : 0) && anchor == viewAnchor;
+    viewAnchor = anchor;
+    viewHisti = st->term.histi;
+
+    // ttywrite scrolls the terminal back down on input, the scrollbar follows it
+    bool atBottom = st->term.scr == 0 || scrollbar.value() == scrollbar.maximum();
 
     if (st->term.histi != scrollbar.maximum()) {
-        bool isMax = scrollbar.value() == scrollbar.value();
         scrollbar.setMaximum(st->term.histi * win.scrollMultiplier);
+        scrollbar.setVisible(scrollbar.maximum() != 0);
+    }
+
+    // stick to the bottom
+    if (atBottom) {
+        scrollOffset = 0;
+        scrollbar.setValue(scrollbar.maximum());
+    }
+
+    if (unchanged) {
+        // only screen lines below the view port changed
+        takeDamage();
+        st->markPainted();
 
-        // stick to the bottom
-        if (isMax) {
-            scrollbar.setValue(scrollbar.maximum());
+        // the cached history lines moved up by the pushed lines, cached screen lines are outdated
+        scrollCacheFirst -= pushed;
+        scrollCacheLast -= pushed;
+        if (scrollCacheLast + pushed > 0 || scrollCacheFirst < -(HISTSIZE - 1)) {
+            invalidateScrollCache();
         }
-        scrollbar.setVisible(scrollbar.maximum() != 0);
+        return;
+    }
+
+    invalidateScrollCache();
+    startBlinking();
+    scheduleFrame(takeDamage());
+}
+
+/*
+ * Collects the lines marked dirty by the terminal and clears their flags
+ * The cursor moves without dirtying lines, so its old and new cell are always included.
+ */
+QRegion QLightTerminal::takeDamage() {
+    int rows = MIN(win.viewPortHeight, st->term.row);
+    bool full = st->term.scr != 0 || scrollOffset != 0; // dirty flags are in screen coordinates
+    int start = -1;
+    QRegion region;
+
+    for (int y = 0; y <= st->term.row; y++) {
+        bool dirty = y < st->term.row && st->term.dirty[y];
+
+        if (dirty) {
+            st->term.dirty[y] = 0;
+            if (start < 0) {
+                start = y;
+            }
+        } else if (start >= 0) {
+            // one rect for each block of dirty lines
+            if (!full && start < rows) {
+                region += QRectF(0, win.vPadding + start * win.lineheight,
+                                 width(), (MIN(y, rows) - start) * win.lineheight).toAlignedRect();
+            }
+            start = -1;
+        }
+    }
+
+    if (full) {
+        return QRegion(rect());
+    }
+
+    region += lastCursorRect;
+    region += cursorRect();
+    return region;
+}
+
+/*
+ * Frame pacing
+ * Damage is gathered and rendered at most once per refresh interval of the screen. If the previous frame
+ * has not been painted when the next one is due, the frame is skipped and the damage carried over.
+ */
+void QLightTerminal::scheduleFrame() {
+    scheduleFrame(QRegion(rect()));
+}
+
+void QLightTerminal::scheduleFrame(const QRegion &region) {
+    // a full frame is rendered once shown again
+    if (hidden) {
+        return;
+    }
+
+    damage += region;
+
+    // blinking and scrolling must not show the half updated screen of a synchronized update (mode 2026),
+    // the damage is kept until its end emits s_updateView
+    if (damage.isEmpty() || frameTimer.isActive() || (st->termMode() & MODE_SYNC)) {
+        return;
+    }
+
+    int interval = frameInterval();
+    qint64 elapsed = frameClock.isValid() ? frameClock.elapsed() : interval;
+    frameTimer.start(MAX(0, interval - elapsed));
+}
+
+void QLightTerminal::presentFrame() {
+    if (st->termMode() & MODE_SYNC) {
+        return; // scheduled again once the synchronized update ends
+    }
+
+    damage &= QRegion(rect());
+
+    if (damage.isEmpty()) {
+        return;
+    }
+
+    int interval = frameInterval();
+
+    // a frame that never gets painted (e.g. hidden widget) must not block all following frames
+    if (framePending && frameClock.elapsed() < 4 * interval) {
+        framesDropped++;
+        frameTimer.start(interval);
+        return;
+    }
+
+    framePending = true;
+    frameClock.start();
+    update(damage);
+    damage = QRegion();
+}
+
+int QLightTerminal::frameInterval() const {
+    QScreen *display = screen();
+    qreal refreshRate = display ? display->refreshRate() : 60;
+
+    if (refreshRate <= 0) {
+        refreshRate = 60;
+    }
+    return MAX(1, qRound(1000 / refreshRate));
+}
+
+/*
+ * Performance statistics
+ * Counters are always collected, timers and the periodic update only run while enabled.
+ */
+void QLightTerminal::setStatsEnabled(bool enabled, int interval) {
+    statsEnabled = enabled;
+    st->setStatsEnabled(enabled);
+
+    if (enabled) {
+        statsClock.start();
+        statsTimer.start(interval);
+        lastStats = collectStats();
+    } else {
+        statsTimer.stop();
+        setStatsOverlay(false);
+    }
+}
+
+void QLightTerminal::setBackpressure(qint64 maxPendingBytes, qint64 maxUnpaintedBytes, int maxPauseMs) {
+    st->setBackpressure(Backpressure{maxPendingBytes, maxUnpaintedBytes, maxPauseMs});
+}
+
+void QLightTerminal::setParseBudget(int bytes, int microseconds) {
+    st->setParseBudget(bytes, microseconds);
+}
+
+void QLightTerminal::setFastForward(bool enabled) {
+    if (enabled == fastForward || closed) {
+        return;
+    }
+
+    fastForward = enabled;
+
+    if (enabled) {
+        fastForwardBytes = st->stats.bytesRead;
+        fastForwardClock.start();
+        settleTimer.start(settleInterval);
+        progressTimer.start(250);
+        stopBlinking();
+        scheduleFrame(progressRect());
+    } else {
+        settleTimer.stop();
+        progressTimer.stop();
+        rateClock.invalidate();
+
+        // catch up with everything that happened in between
+        updateTerminal(&st->term);
+        scheduleFrame();
+    }
+}
+
+void QLightTerminal::setFastForwardThreshold(qint64 bytesPerSecond) {
+    fastForwardThreshold = bytesPerSecond;
+    rateClock.invalidate();
+}
+
+QRect QLightTerminal::progressRect() const {
+    QFontMetricsF metric(fonts[0]);
+    int w = qCeil(metric.horizontalAdvance("fast forward 000000.0 MB  00000.0 MB/s") + 12);
+    int h = qCeil(metric.lineSpacing() + 8);
+
+    // bottom right, clear of the scrollbar
+    return QRect(width() - w - 16, height() - h - 4, w, h);
+}
+
+void QLightTerminal::drawProgress(QPainter &painter) {
+    double mb = (st->stats.bytesRead - fastForwardBytes) / double(1 << 20);
+    double seconds = MAX(fastForwardClock.elapsed(), 1) / 1000.0;
+    QRect box = progressRect();
+
+    painter.setOpacity(1);
+    painter.fillRect(box, QColor(0, 0, 0, 190));
+    painter.setPen(QColor(230, 230, 230));
+    painter.setFont(fonts[0]);
+    painter.drawText(box.adjusted(6, 4, -6, -4), Qt::AlignLeft | Qt::AlignVCenter,
+                     QString::asprintf("fast forward %8.1f MB  %7.1f MB/s", mb, mb / seconds));
+}
+
+void QLightTerminal::setStatsOverlay(bool enabled) {
+    if (enabled && !statsEnabled) {
+        setStatsEnabled(true);
     }
-    update();
+    statsOverlay = enabled;
+    scheduleFrame(overlayRect());
+}
+
+TerminalStats QLightTerminal::stats() const {
+    return lastStats;
+}
+
+/*
+ * Returns the current totals, the rates are left empty
+ */
+TerminalStats QLightTerminal::collectStats() const {
+    TerminalStats current{};
+
+    current.bytesRead = st->stats.bytesRead;
+    current.escapes = st->stats.escapes;
+    current.parseNs = st->stats.parseNs;
+    current.frames = framesPainted;
+    current.droppedFrames = framesDropped;
+    current.paintNs = paintNs;
+    current.spawnNs = st->stats.spawnNs;
+    current.readPauses = st->stats.readPauses;
+    current.pausedNs = st->stats.pausedNs;
+    current.readPaused = st->readPaused();
+    return current;
+}
+
+void QLightTerminal::updateStats() {
+    double seconds = MAX(statsClock.restart(), 1) / 1000.0;
+    TerminalStats current = collectStats();
+    quint64 frames = current.frames - lastStats.frames;
+
+    current.bytesPerSecond = (current.bytesRead - lastStats.bytesRead) / seconds;
+    current.parseTime = (current.parseNs - lastStats.parseNs) / 1e6 / seconds;
+    current.escapesPerSecond = (current.escapes - lastStats.escapes) / seconds;
+    current.framesPerSecond = frames / seconds;
+    current.paintTime = frames ? (current.paintNs - lastStats.paintNs) / 1e6 / frames : 0;
+    current.droppedPerSecond = (current.droppedFrames - lastStats.droppedFrames) / seconds;
+    current.pausedTime = (current.pausedNs - lastStats.pausedNs) / 1e6 / seconds;
+
+    lastStats = current;
+    emit s_stats(current);
+
+    if (statsOverlay) {
+        scheduleFrame(overlayRect());
+    }
+}
+
+QRect QLightTerminal::overlayRect() const {
+    QFontMetricsF metric(fonts[0]);
+    int w = qCeil(metric.horizontalAdvance("pause  00000000.00 ms/s *") + 12);
+    int h = qCeil(metric.lineSpacing() * 7 + 8);
+
+    // keep clear of the scrollbar
+    return QRect(width() - w - 16, 4, w, h);
+}
+
+void QLightTerminal::drawStatsOverlay(QPainter &painter) {
+    QRect box = overlayRect();
+
+    painter.setOpacity(1);
+    painter.fillRect(box, QColor(0, 0, 0, 190));
+    painter.setPen(QColor(230, 230, 230));
+    painter.setFont(fonts[0]);
+    painter.drawText(box.adjusted(6, 4, -6, -4), Qt::AlignLeft | Qt::AlignTop,
+                     QString::asprintf("read   %8.1f KB/s\n"
+                                       "parse  %8.2f ms/s\n"
+                                       "escape %8.0f /s\n"
+                                       "frames %8.1f /s\n"
+                                       "paint  %8.2f ms\n"
+                                       "drop   %8.1f /s\n"
+                                       "pause  %8.2f ms/s%s",
+                                       lastStats.bytesPerSecond / 1024, lastStats.parseTime, lastStats.escapesPerSecond,
+                                       lastStats.framesPerSecond, lastStats.paintTime, lastStats.droppedPerSecond,
+                                       lastStats.pausedTime, lastStats.readPaused ? " *" : ""));
+}
+
+QRect QLightTerminal::cursorRect() const {
+    return cursorCell().toAlignedRect().adjusted(-1, -1, 1, 1);
+}
+
+QRectF QLightTerminal::cursorCell() const {
+    int row = MIN(st->term.c.y, win.viewPortHeight - 1);
+    int width = (st->term.line[st->term.c.y][st->term.c.x].mode & ATTR_WIDE) ? 2 : 1;
+    return QRectF(win.hPadding + st->term.c.x * win.charWith, win.vPadding + row * win.lineheight,
+                  width * win.charWith, win.lineheight);
+}
+
+bool QLightTerminal::cursorBlinks() const {
+    int style = st->cursorStyle();
+    return style == 0 || style % 2 == 1;
 }
 
 void QLightTerminal::scrollX(int n) {
-    int scroll = (st->term.scr - (scrollbar.maximum() - scrollbar.value()) / win.scrollMultiplier);
+    int offset = scrollbar.maximum() - scrollbar.value(); // distance to the bottom in 1/scrollMultiplier lines
+    int scroll = (st->term.scr - offset / win.scrollMultiplier);
 
     if (scroll < 0) {
         st->kscrollup(-scroll);
     } else {
         st->kscrolldown(scroll);
     }
-    update();
+
+    // the remaining fraction of a line is scrolled in pixels
+    scrollOffset = smoothScrolling ? (offset % win.scrollMultiplier) * win.lineheight / win.scrollMultiplier : 0;
+    scheduleFrame();
 }
 
 void QLightTerminal::setFontSize(int size, int weight) {
+    invalidateScrollCache();
+    viewAnchor = -1;
     QFont mono = QFont("Monospace", size, weight);
     mono.setFixedPitch(true);
     mono.setStyleHint(QFont::Monospace);
 
     setFont(mono); // font must be monospace
 
+    // prepare the font variants used by the renderer
+    for (int i = 0; i < 4; i++) {
+        fonts[i] = mono;
+        fonts[i].setBold(i & 1);
+        fonts[i].setItalic(i & 2);
+    }
+    glyphCache.setFonts(fonts);
+    fontGeneration++;
+
     QFontMetricsF metric = QFontMetricsF(mono);
 
     int linespacing = metric.lineSpacing();
     this->win.lineheight = linespacing * this->win.lineHeightScale;
+    this->win.baseline = (this->win.lineheight - metric.height()) / 2 + metric.ascent();
     this->win.fontSize = size;
     auto initialRect = metric.boundingRect("a");
     auto improvedRect = metric.boundingRect(initialRect, 0, "a");
     this->win.charWith = improvedRect.width();
     this->win.charHeight = improvedRect.height();
-    this->update();
+    this->win.underline = metric.underlinePos();
+    this->win.strikeOut = metric.strikeOutPos();
+    this->win.lineWidth = MAX(metric.lineWidth(), 1.0);
+    this->scheduleFrame();
 }
 
 void QLightTerminal::setBackground(QColor color) {
-    this->colors[this->defaultBackground] = color;
+    invalidateScrollCache();
+    this->colors[this->defaultBackground] = color.rgb();
+    this->updatePalette();
     this->updateStyleSheet();
 }
 
 void QLightTerminal::setLineHeightScale(double scale) {
+    invalidateScrollCache();
     QFontMetricsF metric = QFontMetricsF(this->font());
     this->win.lineheight = metric.lineSpacing() * scale;
+    this->win.baseline = (this->win.lineheight - metric.height()) / 2 + metric.ascent();
     this->win.lineHeightScale = scale;
-    this->update();
+    this->scheduleFrame();
+}
+
+void QLightTerminal::setGlyphRunRendering(bool enabled) {
+    invalidateScrollCache();
+    this->glyphRuns = enabled;
+    this->scheduleFrame();
+}
+
+void QLightTerminal::setThreadedRendering(bool enabled) {
+    this->threadedRendering = enabled;
+    this->scheduleFrame();
+}
+
+void QLightTerminal::setSmoothScrolling(bool enabled) {
+    this->smoothScrolling = enabled;
+    this->scrollX(scrollbar.value());
 }
 
 void QLightTerminal::setPadding(double vertical, double horizontal) {
+    invalidateScrollCache();
     this->win.hPadding = horizontal;
     this->win.vPadding = vertical;
-    this->update();
+    this->scheduleFrame();
 }
 
 void QLightTerminal::paintEvent(QPaintEvent *event) {
+    TraceScope trace("paintEvent");
     QPainter painter(this);
-    painter.setBackgroundMode(Qt::BGMode::OpaqueMode);
+    QElapsedTimer paintClock;
+    framePending = false;
+
+    if (statsEnabled) {
+        paintClock.start();
+    }
 
     if (closed) {
         painter.drawText(QPointF(win.hPadding, win.lineheight + win.vPadding), "Terminal is closed.");
         return;
     }
 
-    QFont font;
-    QString line;
-    uint32_t fgColor = 0;
-    uint32_t bgColor = 0;
-    uint32_t cfgColor = 0; // control for change detection
-    uint32_t cbgColor = 0; // control for change detection
-    ushort mode = -1;
-    double offset;
-    bool changed = false;
+    // calculate the view port (line indices intersecting the dirty rect)
+    QRect dirty = event->rect();
+    int rows = MIN(win.viewPortHeight, st->term.row);
+    int first = MAX(dirty.top() - win.vPadding, 0) / win.lineheight;
+    int last = MIN((int) ((dirty.bottom() + 1 - win.vPadding) / win.lineheight) + 1, rows);
+
+    if (st->term.scr != 0 || scrollOffset != 0) {
+        // the cursor is not drawn, it is scrolled out of view
+        painter.save();
+        drawScrolled(painter, rows);
+        painter.restore();
+    } else {
+        if (first < last) {
+            if (threadedRendering && last - first >= 2 * minBandLines) {
+                drawBands(painter, first, last);
+            } else {
+                QVarLengthArray<const Glyph *, 256> lines;
+                for (int i = first; i < last; i++) {
+                    lines.append(TLINE(st->term, i));
+                }
 
-    // calculate the view port
-    int drawOffset = MAX(event->rect().y() - win.vPadding, 0) / win.lineheight;   // line index offset of the viewPort
-    int drawHeight = (event->rect().height()) / win.lineheight;                   // height of the viewPort in lines
-    int drawEnd = drawOffset + drawHeight;                                      // last line index of the viewPort
+                drawBackground(painter, lines.constData(), first, last, true);
+                drawForeground(painter, lines.constData(), first, last, true, glyphCache.rawFonts());
+            }
+        }
 
-    int i = MIN(drawEnd, win.viewPortHeight);
-    int stop = MAX(i - drawHeight, 0);
-    double yPos = i * win.lineheight + win.vPadding;                // y position of the the lastViewPortLine
+        drawCursor(painter);
+    }
+    lastCursorRect = cursorRect();
+    framesPainted++;
+    st->markPainted();
 
-    int temp;
+    if (statsEnabled) {
+        paintNs += paintClock.nsecsElapsed();
+    }
+    if (statsOverlay) {
+        drawStatsOverlay(painter);
+    }
+    if (fastForward) {
+        drawProgress(painter);
+    }
+}
 
-    while (i > stop) {
-        i--;
+/*
+ * Draws the view port while scrolled through the history
+ * The view is shifted by the sub line scrollOffset, which uncovers a part of the line above the view port.
+ * If the lines around the view port are already rendered into the scroll cache, it is blitted instead.
+ */
+void QLightTerminal::drawScrolled(QPainter &painter, int rows) {
+    int scr = st->term.scr;
+    int top = scrollOffset > 0 ? -1 : 0;
 
-        offset = win.hPadding;
-        line = QString();
+    painter.setClipRect(QRectF(0, 0, width(), win.vPadding + rows * win.lineheight), Qt::IntersectClip);
 
-        // same logic as TLine from st-utils
-        Glyph *tLine = ((i) < st->term.scr ? st->term.hist[((i) + st->term.histi - \
-                                                    st->term.scr + HISTSIZE + 1) % HISTSIZE] : \
-                                                    st->term.line[(i) - st->term.scr]);
+    if (scrollCacheValid && scrollCacheFirst <= top - scr && scrollCacheLast >= rows - scr) {
+        painter.drawImage(QPointF(0, win.vPadding + (scrollCacheFirst + scr) * win.lineheight + scrollOffset),
+                          scrollCache);
 
-        for (int j = 0; j < st->term.col; j++) {
-            Glyph g = tLine[j];
-            if (g.mode == ATTR_WDUMMY)
-                continue;
+        // re-center the strip before the view port reaches its borders
+        int margin = (scrollCacheLast - scrollCacheFirst - rows) / 4;
+        if (top - scr - scrollCacheFirst < margin || scrollCacheLast - rows + scr < margin) {
+            prefetchTimer.start();
+        }
+        return;
+    }
+
+    QVarLengthArray<const Glyph *, 256> lines;
+    for (int i = top; i < rows; i++) {
+        lines.append(TLINE(st->term, i));
+    }
+
+    painter.translate(0, scrollOffset);
+    drawBackground(painter, lines.constData(), top, rows, true);
+    drawForeground(painter, lines.constData(), top, rows, true, glyphCache.rawFonts());
+
+    prefetchTimer.start();
+}
+
+/*
+ * Renders a strip of lines around the view port into the scroll cache
+ * Lines in the strip are counted from the first screen line, so they stay valid while scrolling.
+ * The strip covers the view port plus half of it above and below.
+ */
+void QLightTerminal::prefetchScrollCache() {
+    int rows = MIN(win.viewPortHeight, st->term.row);
+    int scr = st->term.scr;
+
+    if (!smoothScrolling || closed || rows <= 0 || (scr == 0 && scrollOffset == 0)) {
+        return;
+    }
+
+    int margin = MAX(rows / 2, 4);
+    int first = MAX(-scr - 1 - margin, -(HISTSIZE - 1));
+    int last = MIN(rows - scr + margin, st->term.row);
+
+    QVarLengthArray<const Glyph *, 256> lines;
+    for (int i = first; i < last; i++) {
+        lines.append(TLINE(st->term, i + scr));
+    }
+
+    qreal dpr = devicePixelRatioF();
+    scrollCache = QImage(QSize(width(), qCeil((last - first) * win.lineheight)) * dpr,
+                         QImage::Format_ARGB32_Premultiplied);
+    scrollCache.setDevicePixelRatio(dpr);
+    scrollCache.fill(Qt::transparent);
+
+    QPainter painter(&scrollCache);
+    painter.translate(0, -(win.vPadding + (first + scr) * win.lineheight));
+    drawBackground(painter, lines.constData(), first + scr, last + scr, true);
+    drawForeground(painter, lines.constData(), first + scr, last + scr, true, glyphCache.rawFonts());
+
+    scrollCacheFirst = first;
+    scrollCacheLast = last;
+    scrollCacheValid = true;
+}
+
+void QLightTerminal::invalidateScrollCache() {
+    scrollCacheValid = false;
+}
+
+/*
+ * Multi-threaded rendering
+ * The lines are copied (with the selection applied) and split into horizontal bands, which are rasterized
+ * into their own images on the render pool. The gui thread waits for all bands and composites them, so the
+ * palette, fonts and glyph cache can not change while the bands are rendered.
+ */
+void QLightTerminal::drawBands(QPainter &painter, int first, int last) {
+    int cols = st->term.col;
+    int count = last - first;
+
+    // snapshot of the visible lines
+    QVector<Glyph> snapshot(count * cols);
+    QVector<const Glyph *> lines(count);
 
-            if (cfgColor != g.fg) {
-                fgColor = g.fg;
-                cfgColor = g.fg;
-                changed = true;
+    for (int i = first; i < last; i++) {
+        Glyph *dst = snapshot.data() + (i - first) * cols;
+        memcpy(dst, TLINE(st->term, i), cols * sizeof(Glyph));
+        lines[i - first] = dst;
+
+        for (int j = 0; j < cols; j++) {
+            if (st->selected(j, i)) {
+                dst[j].mode ^= ATTR_REVERSE;
+            }
+            // resolve new glyphs here, so the render threads only read from the cache
+            if (dst[j].u >= 128) {
+                glyphCache.glyph(fontIndex(dst[j].mode), dst[j].u);
             }
+        }
+    }
+
+    int bandCount = MAX(1, MIN(renderPool.maxThreadCount(), count / minBandLines));
+    int bandLines = DIVCEIL(count, bandCount);
+    qreal dpr = devicePixelRatioF();
+
+    QVector<QImage> bands(bandCount);
+    QVector<int> bandTops(bandCount);
+
+    for (int b = 0; b < bandCount; b++) {
+        int bandFirst = first + b * bandLines;
+        int bandLast = MIN(bandFirst + bandLines, last);
 
-            if (cbgColor != g.bg) {
-                bgColor = g.bg;
-                cbgColor = g.bg;
-                changed = true;
+        if (bandFirst >= bandLast) {
+            break;
+        }
+
+        int top = qFloor(win.vPadding + bandFirst * win.lineheight);
+        int bottom = qCeil(win.vPadding + bandLast * win.lineheight);
+        bandTops[b] = top;
+
+        QImage &image = bands[b];
+        image = QImage(QSize(width(), bottom - top) * dpr, QImage::Format_ARGB32_Premultiplied);
+        image.setDevicePixelRatio(dpr);
+
+        const Glyph *const *bandLinesPtr = lines.constData() + (bandFirst - first);
+
+        renderPool.start([this, &image, top, bandLinesPtr, bandFirst, bandLast]() {
+            const QRawFont *rawFonts = threadRawFonts();
+
+            image.fill(Qt::transparent);
+
+            QPainter bandPainter(&image);
+            bandPainter.translate(0, -top);
+            drawBackground(bandPainter, bandLinesPtr, bandFirst, bandLast, false);
+            drawForeground(bandPainter, bandLinesPtr, bandFirst, bandLast, false, rawFonts);
+        });
+    }
+
+    renderPool.waitForDone();
+
+    for (int b = 0; b < bandCount; b++) {
+        if (!bands[b].isNull()) {
+            painter.drawImage(QPointF(0, bandTops[b]), bands[b]);
+        }
+    }
+}
+
+/*
+ * Raw fonts of the calling render thread, created once per font change
+ * The gui thread waits for all bands, so fonts and fontGeneration do not change meanwhile.
+ */
+const QRawFont *QLightTerminal::threadRawFonts() {
+    if (!bandFonts.hasLocalData()) {
+        bandFonts.setLocalData(new BandFonts{0, {}});
+    }
+
+    BandFonts *local = bandFonts.localData();
+    if (local->generation != fontGeneration) {
+        for (int v = 0; v < GlyphCache::variants; v++) {
+            local->fonts[v] = QRawFont::fromFont(fonts[v]);
+        }
+        local->generation = fontGeneration;
+    }
+    return local->fonts;
+}
+
+/*
+ * Background pass
+ * Neighbouring cells sharing a background are merged into a single span. Spans with the same extent and color
+ * on consecutive lines are merged vertically, so large colored regions cost a single fillRect.
+ * The default background is already painted by the style sheet and skipped.
+ */
+void QLightTerminal::drawBackground(QPainter &painter, const Glyph *const *lines, int first, int last,
+                                    bool markSelection) {
+    typedef struct {
+        int start;      // first column
+        int end;        // column after the last one
+        uint32_t color;
+        int top;        // first line
+        int bottom;     // line after the last one
+    } BgSpan;
+
+    auto flush = [this, &painter](const BgSpan &span) {
+        painter.fillRect(QRectF(win.hPadding + span.start * win.charWith,
+                                win.vPadding + span.top * win.lineheight,
+                                (span.end - span.start) * win.charWith,
+                                (span.bottom - span.top) * win.lineheight),
+                         toBrush(span.color));
+    };
+
+    QVector<BgSpan> open;
+    QVector<BgSpan> next;
+    int cols = st->term.col;
+
+    for (int i = first; i < last; i++) {
+        const Glyph *tLine = lines[i - first];
+        int k = 0; // index of the next unmatched span of the previous line
+        int j = 0;
+
+        next.clear();
+
+        while (j < cols) {
+            int start = j;
+            uint32_t color = cellBackground(tLine, j, i, markSelection);
+
+            while (++j < cols && cellBackground(tLine, j, i, markSelection) == color);
+
+            if (color == defaultBackground) {
+                continue;
             }
 
-            if (st->selected(j, i)) {
-                g.mode ^= ATTR_REVERSE;
+            // spans of the previous line starting left of this one can no longer be extended
+            while (k < open.size() && open[k].start < start) {
+                flush(open[k++]);
             }
 
-            if (mode != g.mode) {
-                mode = g.mode;
-                changed = true;
-                fgColor = cfgColor; // reset color
-                bgColor = cbgColor;
+            if (k < open.size() && open[k].start == start && open[k].end == j && open[k].color == color) {
+                open[k].bottom = i + 1;
+                next.append(open[k++]);
+            } else {
+                next.append(BgSpan{start, j, color, i, i + 1});
+            }
+        }
 
-                if ((g.mode & ATTR_BOLD_FAINT) == ATTR_FAINT) {
-                    painter.setOpacity(0.5);
-                } else {
-                    painter.setOpacity(1);
-                }
+        for (; k < open.size(); k++) {
+            flush(open[k]);
+        }
+        open.swap(next);
+    }
 
-                if (g.mode & ATTR_REVERSE) {
-                    temp = fgColor;
-                    fgColor = bgColor;
-                    bgColor = temp;
-                }
+    for (const BgSpan &span: open) {
+        flush(span);
+    }
+}
+
+/*
+ * Foreground pass
+ * Draws the text without background. A new run is started on every change of color or text attributes.
+ * Runes known to the glyph cache are placed on their cells with a single glyph run, all others are laid out
+ * as text starting at their cell.
+ */
+void QLightTerminal::drawForeground(QPainter &painter, const Glyph *const *lines, int first, int last,
+                                    bool markSelection, const QRawFont *rawFonts) {
+    const ushort textAttrs = ATTR_BOLD | ATTR_FAINT | ATTR_ITALIC | ATTR_UNDERLINE | ATTR_STRUCK;
+    const bool hideBlink = textBlinkOff && st->term.scr == 0 && scrollOffset == 0;
+
+    int runStart = -1;          // first cell of the current run, -1 if no run is open
+    int runEnd = 0;
+    uint32_t runColor = 0;
+    ushort runMode = 0;
+    QColor pen;
+    double yPos = 0;
+    bool initialized = false;
+
+    QList<quint32> glyphs;      // glyph run of the current run
+    QList<QPointF> positions;
+    QString text;               // runes that need text layout
+    int textStart = 0;
+
+    auto flushGlyphs = [&]() {
+        if (glyphs.isEmpty()) {
+            return;
+        }
+
+        QGlyphRun glyphRun;
+        glyphRun.setRawFont(rawFonts[fontIndex(runMode)]);
+        glyphRun.setGlyphIndexes(glyphs);
+        glyphRun.setPositions(positions);
+        painter.drawGlyphRun(QPointF(0, 0), glyphRun);
+
+        glyphs.clear();
+        positions.clear();
+    };
 
-                if (g.mode & ATTR_INVISIBLE)
-                    fgColor = bgColor;
+    auto flushText = [&]() {
+        if (text.isEmpty()) {
+            return;
+        }
 
-                font = painter.font();
+        painter.drawText(QPointF(win.hPadding + textStart * win.charWith, yPos), text);
+        text.clear();
+    };
 
-                bool bold = g.mode & ATTR_BOLD;
-                if (bold != font.bold()) font.setBold(bold);
+    auto flush = [&]() {
+        if (runStart < 0) {
+            return;
+        }
 
-                bool italic = g.mode & ATTR_ITALIC;
-                if (italic != font.italic()) font.setItalic(italic);
+        flushGlyphs();
+        flushText();
 
-                bool underline = g.mode & ATTR_UNDERLINE;
-                if (underline != font.underline()) font.setUnderline(underline);
+        double x = win.hPadding + runStart * win.charWith;
+        double width = (runEnd - runStart) * win.charWith;
 
-                bool strikethrough = g.mode & ATTR_STRUCK;
-                if (strikethrough != font.strikeOut()) font.setStrikeOut(strikethrough);
+        // decorations are plain rects, so they are shared by all font variants
+        if (runMode & ATTR_UNDERLINE) {
+            painter.fillRect(QRectF(x, yPos + win.underline, width, win.lineWidth), pen);
+        }
+        if (runMode & ATTR_STRUCK) {
+            painter.fillRect(QRectF(x, yPos - win.strikeOut, width, win.lineWidth), pen);
+        }
+        runStart = -1;
+    };
+
+    for (int i = first; i < last; i++) {
+        const Glyph *tLine = lines[i - first];
+        yPos = i * win.lineheight + win.vPadding + win.baseline;
+
+        for (int j = 0; j < st->term.col; j++) {
+            Glyph g = tLine[j];
+            if (g.mode & ATTR_WDUMMY)
+                continue;
+
+            if (markSelection && st->selected(j, i)) {
+                g.mode ^= ATTR_REVERSE;
             }
 
-            // draw current line state and change color
-            if (changed) {
-                painter.drawText(QPointF(offset, yPos), line);
-                offset += line.size() * win.charWith;
+            uint32_t fgColor = (g.mode & ATTR_REVERSE) ? g.bg : g.fg;
+            ushort mode = g.mode & textAttrs;
 
-                if (IS_TRUECOL(fgColor)) {
-                    painter.setPen(QColor(RED_FROM_TRUE(fgColor), GREEN_FROM_TRUE(fgColor), BLUE_FROM_TRUE(fgColor)));
-                } else {
-                    painter.setPen(colors[fgColor]);
-                }
+            if ((g.mode & ATTR_INVISIBLE) || ((g.mode & ATTR_BLINK) && hideBlink)) {
+                g.u = ' ';
+            }
+
+            if (!initialized || fgColor != runColor || mode != runMode) {
+                flush();
 
-                if (IS_TRUECOL(bgColor)) {
-                    painter.setBackground(
-                            QBrush(QColor(RED_FROM_TRUE(bgColor), GREEN_FROM_TRUE(bgColor), BLUE_FROM_TRUE(bgColor))));
-                } else {
-                    painter.setBackground(QBrush(colors[bgColor]));
+                if (!initialized || fgColor != runColor
+                    || (mode & ATTR_BOLD_FAINT) != (runMode & ATTR_BOLD_FAINT)) {
+                    pen = QColor::fromRgb(toRgb(fgColor, (mode & ATTR_BOLD_FAINT) == ATTR_FAINT));
+                    painter.setPen(pen);
+                }
+                if (!initialized || fontIndex(mode) != fontIndex(runMode)) {
+                    painter.setFont(fonts[fontIndex(mode)]);
                 }
 
-                line = QString();
-                changed = false;
-                painter.setFont(font);
+                initialized = true;
+                runColor = fgColor;
+                runMode = mode;
+            }
+
+            if (runStart < 0) {
+                runStart = j;
+            }
+            runEnd = j + ((g.mode & ATTR_WIDE) ? 2 : 1);
+
+            if (g.u == ' ' && text.isEmpty()) {
+                continue; // nothing to draw
+            }
+
+            quint32 glyph = glyphRuns ? glyphCache.glyph(fontIndex(mode), g.u) : 0;
+
+            if (glyph != 0) {
+                flushText();
+                glyphs.append(glyph);
+                positions.append(QPointF(win.hPadding + j * win.charWith, yPos));
+                continue;
+            }
+
+            // fall back to text layout for font fallback and complex scripts
+            flushGlyphs();
+            if (text.isEmpty()) {
+                textStart = j;
             }
 
             if (0xffff < g.u) {
-                line += QStringView(QChar::fromUcs4(g.u));
+                text += QStringView(QChar::fromUcs4(g.u));
             } else {
-                line += QChar(g.u);
+                text += QChar(g.u);
             }
 
+            // realign the next glyphs to the grid
+            if (g.mode & ATTR_WIDE) {
+                flushText();
+            }
         }
-        painter.drawText(QPointF(offset, yPos), line);
-        yPos -= win.lineheight;
+        flush();
     }
+}
 
-    if (st->term.scr != 0) {
-        return; // do not draw, cursor is scrolled out of view
+/*
+ * Draws the cursor by reversing foreground color and background color
+ */
+void QLightTerminal::drawCursor(QPainter &painter) {
+    if (st->term.scr != 0 || !cursorVisible) {
+        return; // do not draw, cursor is scrolled out of view or blinked out
     }
 
-    // draw cursor
-    // drawn by reversing foreground color and background color
-    fgColor = st->term.c.attr.bg;
-    if (IS_TRUECOL(fgColor)) {
-        painter.setPen(QColor(RED_FROM_TRUE(fgColor), GREEN_FROM_TRUE(fgColor), BLUE_FROM_TRUE(fgColor)));
-    } else {
-        painter.setPen(colors[fgColor]);
+    QRectF cell = cursorCell();
+    QBrush brush = toBrush(st->term.c.attr.fg);
+    double thickness = MAX(2.0, 2 * win.lineWidth);
+
+    // underline and bar are plain rects over the cell, the text below stays as painted
+    switch (st->cursorStyle()) {
+        case 3: /* Blinking underline */
+        case 4: /* Steady underline */
+            painter.fillRect(QRectF(cell.left(), cell.bottom() - thickness, cell.width(), thickness), brush);
+            return;
+        case 5: /* Blinking bar */
+        case 6: /* Steady bar */
+            painter.fillRect(QRectF(cell.left(), cell.top(), thickness, cell.height()), brush);
+            return;
+        default: /* 0, 1, 2: Block */
+            painter.fillRect(cell, brush);
+            break;
     }
-    bgColor = st->term.c.attr.fg;
-    if (IS_TRUECOL(bgColor)) {
-        painter.setBackground(
-                QBrush(QColor(RED_FROM_TRUE(bgColor), GREEN_FROM_TRUE(bgColor), BLUE_FROM_TRUE(bgColor))));
-    } else {
-        painter.setBackground(QBrush(colors[bgColor]));
+
+    const Glyph &g = st->term.line[st->term.c.y][st->term.c.x];
+    if (g.u == ' ' || (g.mode & (ATTR_WDUMMY | ATTR_INVISIBLE))) {
+        return;
     }
 
-    line = QString();
+    // the rune in the block is placed from the glyph cache, only unknown runes need a text layout
+    int font = fontIndex(g.mode);
+    quint32 glyph = glyphRuns ? glyphCache.glyph(font, g.u) : 0;
+    QPointF cursorPos(cell.left(), cell.top() + win.baseline);
 
-    for (int i = 0; i < st->term.c.x; i++) {
-        auto rune = st->term.line[st->term.c.y][i].u;
+    painter.setPen(QColor::fromRgb(toRgb(st->term.c.attr.bg)));
 
-        if (0xffff < rune) {
-            line += QStringView(QChar::fromUcs4(rune));
+    if (glyph != 0) {
+        QGlyphRun glyphRun;
+        glyphRun.setRawFont(glyphCache.rawFonts()[font]);
+        glyphRun.setGlyphIndexes({glyph});
+        glyphRun.setPositions({cursorPos});
+        painter.drawGlyphRun(QPointF(0, 0), glyphRun);
+    } else {
+        painter.setFont(fonts[font]);
+        if (0xffff < g.u) {
+            painter.drawText(cursorPos, QString(QChar::fromUcs4(g.u)));
         } else {
-            line += QChar(rune);
+            painter.drawText(cursorPos, QChar(g.u));
         }
     }
-    int cursorOffset = line.size() * win.charWith;
+}
 
-    double cursorPosVert = MIN(st->term.c.y + 1, win.viewPortHeight); // line of the cursor
+/*
+ * Returns the background color index of a cell, taking reverse video and the selection into account
+ */
+uint32_t QLightTerminal::cellBackground(const Glyph *line, int col, int row, bool markSelection) {
+    // wide character dummies share the background of their character
+    if (line[col].mode & ATTR_WDUMMY && col > 0) {
+        col--;
+    }
 
-    auto cursorPos = QPointF(cursorOffset + win.hPadding, cursorPosVert * win.lineheight + win.vPadding);
+    const Glyph &g = line[col];
+    bool reverse = g.mode & ATTR_REVERSE;
 
-    if (!cursorVisible) {
-        return;
+    if (markSelection && st->selected(col, row)) {
+        reverse = !reverse;
     }
 
-    auto runeAtCursor = st->term.line[st->term.c.y][st->term.c.x].u;
+    return reverse ? g.fg : g.bg;
+}
 
-    if (0xffff < runeAtCursor) {
-        painter.drawText(cursorPos, QString(QChar::fromUcs4(runeAtCursor)));
-    } else {
-        painter.drawText(cursorPos, QChar(runeAtCursor));
+/*
+ * Precomputes the faint variants and brushes of the palette
+ * Needs to be called after every palette change
+ */
+void QLightTerminal::updatePalette() {
+    for (int i = 0; i < 260; i++) {
+        QRgb c = colors[i];
+        faintColors[i] = qRgb(qRed(c) / 2, qGreen(c) / 2, qBlue(c) / 2);
+        brushes[i] = QBrush(QColor::fromRgb(c));
     }
+    trueColorBrushes.clear();
+}
 
+QRgb QLightTerminal::toRgb(uint32_t color, bool faint) const {
+    if (IS_TRUECOL(color)) {
+        if (faint) {
+            return qRgb(RED_FROM_TRUE(color) / 2, GREEN_FROM_TRUE(color) / 2, BLUE_FROM_TRUE(color) / 2);
+        }
+        return qRgb(RED_FROM_TRUE(color), GREEN_FROM_TRUE(color), BLUE_FROM_TRUE(color));
+    }
+    return faint ? faintColors[color] : colors[color];
+}
 
-    /**
-     *  TODO Add later
-     *  if ((base.mode & ATTR_BOLD_FAINT) == ATTR_FAINT) {
-             colfg.red = fg->color.red / 2;
-             colfg.green = fg->color.green / 2;
-             colfg.blue = fg->color.blue / 2;
-             colfg.alpha = fg->color.alpha;
-             XftColorAllocValue(xw.dpy, xw.vis, xw.cmap, &colfg, &revfg);
-             fg = &revfg;
-         }
+QBrush QLightTerminal::toBrush(uint32_t color) {
+    if (!IS_TRUECOL(color)) {
+        return brushes[color];
+    }
 
-         if (base.mode & ATTR_BLINK && win.mode & MODE_BLINK)
-             fg = bg;
-     */
+    // shared by the render threads
+    QMutexLocker locker(&brushLock);
+
+    auto it = trueColorBrushes.find(color);
+    if (it == trueColorBrushes.end()) {
+        // true color images can use any number of colors, keep the cache bounded
+        if (trueColorBrushes.size() > 4096) {
+            trueColorBrushes.clear();
+        }
+        it = trueColorBrushes.insert(color, QBrush(QColor::fromRgb(toRgb(color))));
+    }
+    return it.value();
+}
+
+/*
+ * Index into fonts for the given glyph mode
+ */
+int QLightTerminal::fontIndex(ushort mode) {
+    return ((mode & ATTR_BOLD) ? 1 : 0) | ((mode & ATTR_ITALIC) ? 2 : 0);
 }
 
 /*
@@ -418,7 +1209,8 @@ void QLightTerminal::mousePressEvent(QMouseEvent *event) {
 
     // reset old selection
     st->selclear();
-    update();
+    invalidateScrollCache();
+    scheduleFrame();
 
     // select line if tripple click
     if (QDateTime::currentMSecsSinceEpoch() - lastClick < 500) {
@@ -431,9 +1223,8 @@ void QLightTerminal::mousePressEvent(QMouseEvent *event) {
     }
 
     // draw cursor
-    cursorVisible = true;
-    update(); // draw cursor
-    cursorTimer.start(750);
+    startBlinking();
+    scheduleFrame(); // draw cursor
 }
 
 void QLightTerminal::mouseReleaseEvent(QMouseEvent *event) {
@@ -449,9 +1240,10 @@ void QLightTerminal::mouseReleaseEvent(QMouseEvent *event) {
         row = MIN(row, win.viewPortHeight - 1);
 
         st->selextend(col, row, SEL_REGULAR, 1);
+        invalidateScrollCache();
         selectionStarted = false;
         selectionTimer.stop();
-        update();
+        scheduleFrame();
     }
 };
 
@@ -470,6 +1262,7 @@ void QLightTerminal::mouseMoveEvent(QMouseEvent *event) {
             }
 
             st->selstart(col, row, 0);
+            invalidateScrollCache();
             selectionTimer.start(100);
             selectionStarted = true;
         }
@@ -484,10 +1277,10 @@ bool QLightTerminal::focusNextPrevChild(bool next) {
 void QLightTerminal::updateStyleSheet() {
     QString stylesheet;
 
-    stylesheet += "background-color:" + this->colors[this->defaultBackground].name() + ";";
+    stylesheet += "background-color:" + QColor::fromRgb(this->colors[this->defaultBackground]).name() + ";";
 
     setStyleSheet(stylesheet);
-    this->update();
+    this->scheduleFrame();
 };
 
 void QLightTerminal::updateSelection() {
@@ -511,7 +1304,8 @@ void QLightTerminal::updateSelection() {
         row = MIN(row, win.viewPortHeight - 1);
 
         st->selextend(col, row, SEL_REGULAR, 0);
-        update();
+        invalidateScrollCache();
+        scheduleFrame();
     }
 }
 
@@ -530,10 +1324,11 @@ void QLightTerminal::mouseDoubleClickEvent(QMouseEvent *event) {
 
     st->selclear();
     st->selstart(col, row, SNAP_WORD);
+    invalidateScrollCache();
 
     lastClick = QDateTime::currentMSecsSinceEpoch();
 
-    update();
+    scheduleFrame();
 }
 
 void QLightTerminal::resizeEvent(QResizeEvent *event) {
@@ -556,6 +1351,7 @@ void QLightTerminal::resizeEvent(QResizeEvent *event) {
 
 void QLightTerminal::resize() {
     resizeTimer.stop();
+    viewAnchor = -1;
 
     int paddingBottom = 4;
     int rows = (win.height - win.vPadding * 2 - paddingBottom) / win.lineheight;
@@ -570,6 +1366,7 @@ void QLightTerminal::resize() {
 
     win.viewPortWidth = cols;
     win.viewPortHeight = rows;
+    invalidateScrollCache();
 
     st->tresize(cols, win.viewPortHeight);
     st->ttyresize(cols * 8.5, win.viewPortHeight * win.lineheight);
@@ -580,8 +1377,8 @@ void QLightTerminal::wheelEvent(QWheelEvent *event) {
     event->accept();
 
     if (!numPixels.isNull()) {
-        // TODO: test if this works << needs mouse with finer resolution
-        scrollbar.setValue(scrollbar.value() - numPixels.y() * 2);
+        // pixel exact scrolling for touchpads and high resolution wheels
+        scrollbar.setValue(scrollbar.value() - numPixels.y() * win.scrollMultiplier / win.lineheight);
         return;
     }
 
@@ -593,11 +1390,149 @@ void QLightTerminal::wheelEvent(QWheelEvent *event) {
     }
 }
 
+void QLightTerminal::focusInEvent(QFocusEvent *event) {
+    startBlinking();
+    // redraw cursor position
+    scheduleFrame(cursorRect());
+}
+
 void QLightTerminal::focusOutEvent(QFocusEvent *event) {
-    cursorTimer.stop();
+    stopBlinking();
     cursorVisible = false;
     // redraw cursor position
-    update();
+    scheduleFrame();
+}
+
+/*
+ * Blinking
+ * The cursor and blinking text follow the phase of the shared AnimationClock, so all terminals blink together. The
+ * cursor stays on for at least one phase after output or a click and only blinks while the terminal has focus. Only
+ * the cells of blinking text are repainted on a phase change, they are found through the blinking cell count of each
+ * line.
+ */
+void QLightTerminal::startBlinking() {
+    cursorVisible = true;
+    cursorActivity.start();
+
+    // an unfocused terminal shows a steady cursor and is not woken up for it
+    cursorBlinking = hasFocus();
+    updateClock();
+}
+
+void QLightTerminal::stopBlinking() {
+    cursorBlinking = false;
+    updateClock();
+}
+
+/*
+ * Subscribes to the clock while the cursor or any text blinks
+ */
+void QLightTerminal::updateClock() {
+    bool wanted = !hidden && !closed && ((cursorBlinking && cursorBlinks()) || st->blinking());
+    bool textOff = textBlinkOff;
+
+    if (wanted && !blinkConnection) {
+        blinkConnection = connect(AnimationClock::instance(), &AnimationClock::s_tick,
+                                  this, &QLightTerminal::animationTick);
+        textBlinkOff = !AnimationClock::instance()->phase();
+    } else if (!wanted && blinkConnection) {
+        disconnect(blinkConnection);
+        blinkConnection = QMetaObject::Connection();
+        textBlinkOff = false;
+    }
+
+    if (textOff != textBlinkOff && st->blinking()) {
+        scheduleFrame(blinkRegion());
+    }
+}
+
+void QLightTerminal::animationTick(bool on) {
+    if (cursorBlinking && cursorBlinks()) {
+        bool visible = on || cursorActivity.elapsed() < AnimationClock::interval;
+
+        if (visible != cursorVisible) {
+            cursorVisible = visible;
+            scheduleFrame(cursorRect());
+        }
+    }
+
+    if (textBlinkOff != !on) {
+        textBlinkOff = !on;
+
+        QRegion region = blinkRegion();
+        if (!fastForward && !region.isEmpty()) {
+            scheduleFrame(region);
+        }
+    }
+}
+
+/*
+ * Cells of the view port with blinking text, nothing blinks while scrolled through the history
+ */
+QRegion QLightTerminal::blinkRegion() const {
+    int rows = MIN(win.viewPortHeight, st->term.row);
+    QRegion region;
+
+    if (st->term.scr != 0 || scrollOffset != 0) {
+        return region;
+    }
+
+    for (int y = 0; y < rows; y++) {
+        if (st->blinkCount(y) <= 0) {
+            continue;
+        }
+
+        const Glyph *line = st->term.line[y];
+        for (int x = 0; x < st->term.col; x++) {
+            if (line[x].mode & ATTR_BLINK) {
+                int width = (line[x].mode & ATTR_WIDE) ? 2 : 1;
+                region += QRectF(win.hPadding + x * win.charWith, win.vPadding + y * win.lineheight,
+                                 width * win.charWith, win.lineheight).toAlignedRect();
+            }
+        }
+    }
+    return region;
+}
+
+/*
+ * Power saving
+ * While hidden (e.g. a background tab or a minimized window) no timer of the widget runs and nothing is rendered.
+ * The terminal keeps parsing so the shell never blocks, a single full frame is rendered when shown again.
+ */
+void QLightTerminal::showEvent(QShowEvent *event) {
+    if (!hidden) {
+        return;
+    }
+    hidden = false;
+
+    if (!closed && !fastForward) {
+        startBlinking();
+    }
+    if (fastForward) {
+        progressTimer.start(250);
+    }
+
+    // updates the scrollbar for the output parsed meanwhile
+    st->setVisible(true);
+    updateClock();
+    scheduleFrame();
+}
+
+void QLightTerminal::hideEvent(QHideEvent *event) {
+    if (hidden) {
+        return;
+    }
+    hidden = true;
+
+    stopBlinking();
+    selectionTimer.stop();
+    progressTimer.stop();
+    prefetchTimer.stop();
+    frameTimer.stop();
+    damage = QRegion();
+    framePending = false;
+
+    st->setVisible(false);
 }
 
 void QLightTerminal::setupScrollbar() {
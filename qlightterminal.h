@@ -14,8 +14,20 @@
 #include <QPointF>
 #include <QTime>
 #include <QColor>
+#include <QPainter>
+#include <QFont>
+#include <QBrush>
+#include <QHash>
+#include <QMutex>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QRawFont>
+#include <QImage>
+#include <QRegion>
+#include <QElapsedTimer>
 
 #include "st.h"
+#include "glyphcache.h"
 
 typedef struct {
     Qt::Key key;
@@ -38,14 +50,45 @@ typedef struct {
     double charWith;
     int vPadding;
     int hPadding;
+    double baseline; // distance from the top of a line to the text baseline
+    double underline; // distance from the baseline to the underline
+    double strikeOut; // distance from the baseline to the strike out line
+    double lineWidth; // width of underline and strike out lines
 } Window;
 
+typedef struct {
+    // rates over the last stats interval
+    double bytesPerSecond; // bytes read from the tty
+    double parseTime; // ms per second spent in twrite
+    double escapesPerSecond; // escape sequences handled
+    double framesPerSecond; // frames painted
+    double paintTime; // average duration of a paint in ms
+    double droppedPerSecond; // frames skipped because the previous one was not painted yet
+    double pausedTime; // ms per second reading was paused by backpressure
+    bool readPaused; // reading is paused right now
+    // totals since the terminal was created
+    quint64 bytesRead;
+    quint64 escapes;
+    quint64 parseNs;
+    quint64 frames;
+    quint64 droppedFrames;
+    quint64 paintNs;
+    quint64 spawnNs; // time to open the pty and start the shell
+    quint64 readPauses;
+    quint64 pausedNs;
+} TerminalStats;
+
 class QLightTerminal : public QWidget {
     Q_OBJECT
 
 public:
     QLightTerminal(QWidget *parent = nullptr);
 
+    /*
+     * Displays an existing terminal core, e.g. one attached to a custom transport, takes ownership of it
+     */
+    QLightTerminal(SimpleTerminal *terminal, QWidget *parent = nullptr);
+
 public
     slots:
             void updateTerminal(Term * term);
@@ -64,6 +107,62 @@ public
 
     void setPadding(double vertical, double horizontal);
 
+    /*
+     * Draws text as positioned glyph runs instead of laid out strings (enabled by default)
+     * Runes needing shaping or font fallback always use the text layout
+     */
+    void setGlyphRunRendering(bool enabled);
+
+    /*
+     * Rasterizes large repaints in horizontal bands on a thread pool (disabled by default)
+     * The number of bands follows the number of cores
+     */
+    void setThreadedRendering(bool enabled);
+
+    /*
+     * Scrolls through the history in pixels instead of whole lines (enabled by default)
+     */
+    void setSmoothScrolling(bool enabled);
+
+    /*
+     * Collects performance statistics and emits them every interval ms through s_stats (disabled by default)
+     */
+    void setStatsEnabled(bool enabled, int interval = 1000);
+
+    /*
+     * Draws the statistics on top of the terminal, enables the statistics if needed
+     */
+    void setStatsOverlay(bool enabled);
+
+    TerminalStats stats() const; // statistics of the last interval
+
+    /*
+     * Pauses reading from the shell for at most maxPauseMs while more than maxPendingBytes are unparsed or more than
+     * maxUnpaintedBytes were parsed since the last paint, 0 disables a limit
+     * Only the unpainted limit is set by default. Unparsed bytes are counted in the transport buffer (at most 1 MiB with
+     * the IoMultiplexer, none otherwise) plus the input waiting for its parse slice, so maxPendingBytes has to stay below
+     * that to ever trigger.
+     */
+    void setBackpressure(qint64 maxPendingBytes, qint64 maxUnpaintedBytes, int maxPauseMs = 100);
+
+    /*
+     * Parses at most bytes or microseconds of output per event loop turn, 0 for no limit (4 ms by default)
+     */
+    void setParseBudget(int bytes, int microseconds);
+
+    /*
+     * Suspends rendering while the output floods in, only a progress indicator is drawn until the output settles
+     * Parsing, scrollback and input keep working as usual.
+     */
+    void setFastForward(bool enabled);
+
+    /*
+     * Enters fast forward automatically above this input rate in bytes per second, 0 disables it
+     */
+    void setFastForwardThreshold(qint64 bytesPerSecond);
+
+    bool isFastForwarding() const { return fastForward; }
+
     void close();
 
     signals:
@@ -71,6 +170,8 @@ public
 
     void s_error(QString);
 
+    void s_stats(TerminalStats stats); // emitted every stats interval if enabled
+
 protected:
     void keyPressEvent(QKeyEvent *event) override;
 
@@ -78,8 +179,14 @@ protected:
 
     void wheelEvent(QWheelEvent *event) override;
 
+    void focusInEvent(QFocusEvent *event) override;
+
     void focusOutEvent(QFocusEvent *event) override;
 
+    void showEvent(QShowEvent *event) override;
+
+    void hideEvent(QHideEvent *event) override;
+
     void mousePressEvent(QMouseEvent *event) override;
 
     void mouseDoubleClickEvent(QMouseEvent *event) override;
@@ -92,25 +199,121 @@ protected:
 
     void paintEvent(QPaintEvent *event) override;
 
-private:
     SimpleTerminal *st;
+
+private:
     QScrollBar scrollbar;
     QHBoxLayout boxLayout;
-    QTimer cursorTimer;
     QTimer selectionTimer;
     QTimer resizeTimer;
+    QTimer prefetchTimer;
+    QTimer frameTimer;
+    QTimer statsTimer;
+    QTimer settleTimer;
+    QTimer progressTimer;
     Window win;
 
+    bool statsEnabled = false;
+    bool statsOverlay = false;
+
+    bool fastForward = false;
+    qint64 fastForwardThreshold = 32 << 20;
+    const int settleInterval = 200; // ms without output that end fast forward
+    QElapsedTimer rateClock;       // current window of the input rate
+    quint64 rateBytes = 0;         // bytes read at the start of the window
+    QElapsedTimer fastForwardClock;
+    quint64 fastForwardBytes = 0;  // bytes read when fast forward started
+    TerminalStats lastStats{};                     // last published statistics
+    QElapsedTimer statsClock;
+    quint64 framesPainted = 0;
+    quint64 framesDropped = 0;
+    quint64 paintNs = 0;                        // only measured while statistics are enabled
+
+    QRegion damage;                             // damage not yet handed to the paint system
+    QElapsedTimer frameClock;                   // time since the last frame was requested
+    bool framePending = false;                  // requested frame not painted yet
+    bool hidden = false;                        // hidden or minimized, the output is parsed only
+    QRect lastCursorRect;                       // cursor area of the last paint
+
     double cursorVisible = true;
+    QElapsedTimer cursorActivity;               // last output or click, the cursor stays on for a phase
+    bool cursorBlinking = false;
+    bool textBlinkOff = false;                  // blinking text is hidden in the current phase
+    QMetaObject::Connection blinkConnection;    // subscription to the AnimationClock
 
     void setupScrollbar();
 
+    void startBlinking();
+
+    void stopBlinking();
+
+    void updateClock();
+
+    bool cursorBlinks() const; // the cursor style blinks (DECSCUSR)
+
+    void animationTick(bool on);
+
+    QRegion blinkRegion() const;
+
     void updateStyleSheet();
 
     void updateSelection();
 
     void resize();
 
+    QRegion takeDamage();
+
+    void scheduleFrame();
+
+    void scheduleFrame(const QRegion &region);
+
+    void presentFrame();
+
+    int frameInterval() const;
+
+    QRect cursorRect() const;
+
+    QRectF cursorCell() const;
+
+    TerminalStats collectStats() const;
+
+    void updateStats();
+
+    QRect overlayRect() const;
+
+    void drawStatsOverlay(QPainter &painter);
+
+    QRect progressRect() const;
+
+    void drawProgress(QPainter &painter);
+
+    void drawBands(QPainter &painter, int first, int last);
+
+    const QRawFont *threadRawFonts();
+
+    void drawScrolled(QPainter &painter, int rows);
+
+    void prefetchScrollCache();
+
+    void invalidateScrollCache();
+
+    void drawBackground(QPainter &painter, const Glyph *const *lines, int first, int last, bool markSelection);
+
+    void drawForeground(QPainter &painter, const Glyph *const *lines, int first, int last, bool markSelection,
+                        const QRawFont *rawFonts);
+
+    void drawCursor(QPainter &painter);
+
+    uint32_t cellBackground(const Glyph *line, int col, int row, bool markSelection);
+
+    void updatePalette();
+
+    QRgb toRgb(uint32_t color, bool faint = false) const;
+
+    QBrush toBrush(uint32_t color);
+
+    static int fontIndex(ushort mode);
+
     bool closed = false;
     qint64 lastClick = 0;
     bool mouseDown = false;
@@ -151,273 +354,319 @@ private:
         { Qt::Key_F9, Qt::NoModifier, "\033[20~", 6, 1 },
     };
 
+    /*
+     * Render state prepared once per font or palette change
+     */
+    QFont fonts[4];                             // regular, bold, italic, bold italic (see fontIndex)
+    QRgb faintColors[260];                      // palette at half intensity for ATTR_FAINT
+    QBrush brushes[260];                        // brushes of the palette colors
+    QHash<uint32_t, QBrush> trueColorBrushes;   // brushes of recently used true colors
+    QMutex brushLock;                           // guards trueColorBrushes
+    GlyphCache glyphCache;                      // glyph indices of the font variants
+    bool glyphRuns = true;
+
+    /*
+     * Raw fonts of a render thread, raw fonts are bound to the font engines of the thread that created them
+     * Declared before renderPool, so the threads finish (and free their fonts) before the storage goes away.
+     */
+    typedef struct {
+        quint64 generation;                     // fontGeneration the fonts were created for
+        QRawFont fonts[GlyphCache::variants];
+    } BandFonts;
+
+    QThreadStorage<BandFonts *> bandFonts;
+    quint64 fontGeneration = 0;                 // bumped on every font change
+
+    QThreadPool renderPool;                     // render threads of the band renderer
+    bool threadedRendering = false;
+    const int minBandLines = 8;                 // smallest band worth its own thread
+
+    /*
+     * Smooth scrolling
+     * The scroll cache holds the pre-rendered lines [scrollCacheFirst, scrollCacheLast), counted from the
+     * first screen line (history lines are negative). It is dropped on any change of the content.
+     */
+    bool smoothScrolling = true;
+    double scrollOffset = 0;                    // sub line part of the scroll position in pixels
+    QImage scrollCache;
+    int scrollCacheFirst = 0;
+    int scrollCacheLast = 0;
+    bool scrollCacheValid = false;
+
+    /*
+     * History position of the view at the last update
+     * While output only adds lines below a view port that lies in the history, the view is not repainted.
+     */
+    int viewAnchor = -1;                        // history index above the first line of the view port
+    int viewHisti = 0;
+
     /*
      * Terminal colors (same as xterm)
      */
-    QColor colors[260] = {
+    QRgb colors[260] = {
             // 8 normal Colors
-            QColor(0, 0, 0),          // Black
-            QColor(240, 82, 79),      // Red
-            QColor(98, 177, 32),      // Green
-            QColor(166, 138, 13),     // Yellow
-            QColor(57, 147, 212),     // Blue
-            QColor(167, 113, 191),    // Magenta
-            QColor(0, 163, 163),      // Cyan
-            QColor(128, 128, 128),    // Gray
+            qRgb(0, 0, 0),            // Black
+            qRgb(240, 82, 79),        // Red
+            qRgb(98, 177, 32),        // Green
+            qRgb(166, 138, 13),       // Yellow
+            qRgb(57, 147, 212),       // Blue
+            qRgb(167, 113, 191),      // Magenta
+            qRgb(0, 163, 163),        // Cyan
+            qRgb(128, 128, 128),      // Gray
             // 8 bright colors
-            QColor(89, 89, 89),       // Dark Gray
-            QColor(255, 64, 80),      // Bright Red
-            QColor(79, 196, 20),      // Bright Green
-            QColor(229, 191, 0),      // Bright Yellow
-            QColor(31, 176, 225),     // Bright Blue
-            QColor(237, 126, 237),    // Bright Magenta
-            QColor(0, 229, 229),     // Bright Cyan
-            QColor(255, 255, 255),    // White
-            QColor(0, 0, 0),
-            QColor(0, 0, 95),
-            QColor(0, 0, 135),
-            QColor(0, 0, 175),
-            QColor(0, 0, 215),
-            QColor(0, 0, 255),
-            QColor(0, 95, 0),
-            QColor(0, 95, 95),
-            QColor(0, 95, 135),
-            QColor(0, 95, 175),
-            QColor(0, 95, 215),
-            QColor(0, 95, 255),
-            QColor(0, 135, 0),
-            QColor(0, 135, 95),
-            QColor(0, 135, 135),
-            QColor(0, 135, 175),
-            QColor(0, 135, 215),
-            QColor(0, 135, 255),
-            QColor(0, 175, 0),
-            QColor(0, 175, 95),
-            QColor(0, 175, 135),
-            QColor(0, 175, 175),
-            QColor(0, 175, 215),
-            QColor(0, 175, 255),
-            QColor(0, 215, 0),
-            QColor(0, 215, 95),
-            QColor(0, 215, 135),
-            QColor(0, 215, 175),
-            QColor(0, 215, 215),
-            QColor(0, 215, 255),
-            QColor(0, 255, 0),
-            QColor(0, 255, 95),
-            QColor(0, 255, 135),
-            QColor(0, 255, 175),
-            QColor(0, 255, 215),
-            QColor(0, 255, 255),
-            QColor(95, 0, 0),
-            QColor(95, 0, 95),
-            QColor(95, 0, 135),
-            QColor(95, 0, 175),
-            QColor(95, 0, 215),
-            QColor(95, 0, 255),
-            QColor(95, 95, 0),
-            QColor(95, 95, 95),
-            QColor(95, 95, 135),
-            QColor(95, 95, 175),
-            QColor(95, 95, 215),
-            QColor(95, 95, 255),
-            QColor(95, 135, 0),
-            QColor(95, 135, 95),
-            QColor(95, 135, 135),
-            QColor(95, 135, 175),
-            QColor(95, 135, 215),
-            QColor(95, 135, 255),
-            QColor(95, 175, 0),
-            QColor(95, 175, 95),
-            QColor(95, 175, 135),
-            QColor(95, 175, 175),
-            QColor(95, 175, 215),
-            QColor(95, 175, 255),
-            QColor(95, 215, 0),
-            QColor(95, 215, 95),
-            QColor(95, 215, 135),
-            QColor(95, 215, 175),
-            QColor(95, 215, 215),
-            QColor(95, 215, 255),
-            QColor(95, 255, 0),
-            QColor(95, 255, 95),
-            QColor(95, 255, 135),
-            QColor(95, 255, 175),
-            QColor(95, 255, 215),
-            QColor(95, 255, 255),
-            QColor(135, 0, 0),
-            QColor(135, 0, 95),
-            QColor(135, 0, 135),
-            QColor(135, 0, 175),
-            QColor(135, 0, 215),
-            QColor(135, 0, 255),
-            QColor(135, 95, 0),
-            QColor(135, 95, 95),
-            QColor(135, 95, 135),
-            QColor(135, 95, 175),
-            QColor(135, 95, 215),
-            QColor(135, 95, 255),
-            QColor(135, 135, 0),
-            QColor(135, 135, 95),
-            QColor(135, 135, 135),
-            QColor(135, 135, 175),
-            QColor(135, 135, 215),
-            QColor(135, 135, 255),
-            QColor(135, 175, 0),
-            QColor(135, 175, 95),
-            QColor(135, 175, 135),
-            QColor(135, 175, 175),
-            QColor(135, 175, 215),
-            QColor(135, 175, 255),
-            QColor(135, 215, 0),
-            QColor(135, 215, 95),
-            QColor(135, 215, 135),
-            QColor(135, 215, 175),
-            QColor(135, 215, 215),
-            QColor(135, 215, 255),
-            QColor(135, 255, 0),
-            QColor(135, 255, 95),
-            QColor(135, 255, 135),
-            QColor(135, 255, 175),
-            QColor(135, 255, 215),
-            QColor(135, 255, 255),
-            QColor(175, 0, 0),
-            QColor(175, 0, 95),
-            QColor(175, 0, 135),
-            QColor(175, 0, 175),
-            QColor(175, 0, 215),
-            QColor(175, 0, 255),
-            QColor(175, 95, 0),
-            QColor(175, 95, 95),
-            QColor(175, 95, 135),
-            QColor(175, 95, 175),
-            QColor(175, 95, 215),
-            QColor(175, 95, 255),
-            QColor(175, 135, 0),
-            QColor(175, 135, 95),
-            QColor(175, 135, 135),
-            QColor(175, 135, 175),
-            QColor(175, 135, 215),
-            QColor(175, 135, 255),
-            QColor(175, 175, 0),
-            QColor(175, 175, 95),
-            QColor(175, 175, 135),
-            QColor(175, 175, 175),
-            QColor(175, 175, 215),
-            QColor(175, 175, 255),
-            QColor(175, 215, 0),
-            QColor(175, 215, 95),
-            QColor(175, 215, 135),
-            QColor(175, 215, 175),
-            QColor(175, 215, 215),
-            QColor(175, 215, 255),
-            QColor(175, 255, 0),
-            QColor(175, 255, 95),
-            QColor(175, 255, 135),
-            QColor(175, 255, 175),
-            QColor(175, 255, 215),
-            QColor(175, 255, 255),
-            QColor(215, 0, 0),
-            QColor(215, 0, 95),
-            QColor(215, 0, 135),
-            QColor(215, 0, 175),
-            QColor(215, 0, 215),
-            QColor(215, 0, 255),
-            QColor(215, 95, 0),
-            QColor(215, 95, 95),
-            QColor(215, 95, 135),
-            QColor(215, 95, 175),
-            QColor(215, 95, 215),
-            QColor(215, 95, 255),
-            QColor(215, 135, 0),
-            QColor(215, 135, 95),
-            QColor(215, 135, 135),
-            QColor(215, 135, 175),
-            QColor(215, 135, 215),
-            QColor(215, 135, 255),
-            QColor(215, 175, 0),
-            QColor(215, 175, 95),
-            QColor(215, 175, 135),
-            QColor(215, 175, 175),
-            QColor(215, 175, 215),
-            QColor(215, 175, 255),
-            QColor(215, 215, 0),
-            QColor(215, 215, 95),
-            QColor(215, 215, 135),
-            QColor(215, 215, 175),
-            QColor(215, 215, 215),
-            QColor(215, 215, 255),
-            QColor(215, 255, 0),
-            QColor(215, 255, 95),
-            QColor(215, 255, 135),
-            QColor(215, 255, 175),
-            QColor(215, 255, 215),
-            QColor(215, 255, 255),
-            QColor(255, 0, 0),
-            QColor(255, 0, 95),
-            QColor(255, 0, 135),
-            QColor(255, 0, 175),
-            QColor(255, 0, 215),
-            QColor(255, 0, 255),
-            QColor(255, 95, 0),
-            QColor(255, 95, 95),
-            QColor(255, 95, 135),
-            QColor(255, 95, 175),
-            QColor(255, 95, 215),
-            QColor(255, 95, 255),
-            QColor(255, 135, 0),
-            QColor(255, 135, 95),
-            QColor(255, 135, 135),
-            QColor(255, 135, 175),
-            QColor(255, 135, 215),
-            QColor(255, 135, 255),
-            QColor(255, 175, 0),
-            QColor(255, 175, 95),
-            QColor(255, 175, 135),
-            QColor(255, 175, 175),
-            QColor(255, 175, 215),
-            QColor(255, 175, 255),
-            QColor(255, 215, 0),
-            QColor(255, 215, 95),
-            QColor(255, 215, 135),
-            QColor(255, 215, 175),
-            QColor(255, 215, 215),
-            QColor(255, 215, 255),
-            QColor(255, 255, 0),
-            QColor(255, 255, 95),
-            QColor(255, 255, 135),
-            QColor(255, 255, 175),
-            QColor(255, 255, 215),
-            QColor(255, 255, 255),
-            QColor(8, 8, 8),
-            QColor(18, 18, 18),
-            QColor(28, 28, 28),
-            QColor(38, 38, 38),
-            QColor(48, 48, 48),
-            QColor(58, 58, 58),
-            QColor(68, 68, 68),
-            QColor(78, 78, 78),
-            QColor(88, 88, 88),
-            QColor(98, 98, 98),
-            QColor(108, 108, 108),
-            QColor(118, 118, 118),
-            QColor(128, 128, 128),
-            QColor(138, 138, 138),
-            QColor(148, 148, 148),
-            QColor(158, 158, 158),
-            QColor(168, 168, 168),
-            QColor(178, 178, 178),
-            QColor(188, 188, 188),
-            QColor(198, 198, 198),
-            QColor(208, 208, 208),
-            QColor(218, 218, 218),
-            QColor(228, 228, 228),
-            QColor(238, 238, 238),
+            qRgb(89, 89, 89),         // Dark Gray
+            qRgb(255, 64, 80),        // Bright Red
+            qRgb(79, 196, 20),        // Bright Green
+            qRgb(229, 191, 0),        // Bright Yellow
+            qRgb(31, 176, 225),       // Bright Blue
+            qRgb(237, 126, 237),      // Bright Magenta
+            qRgb(0, 229, 229),       // Bright Cyan
+            qRgb(255, 255, 255),      // White
+            qRgb(0, 0, 0),
+            qRgb(0, 0, 95),
+            qRgb(0, 0, 135),
+            qRgb(0, 0, 175),
+            qRgb(0, 0, 215),
+            qRgb(0, 0, 255),
+            qRgb(0, 95, 0),
+            qRgb(0, 95, 95),
+            qRgb(0, 95, 135),
+            qRgb(0, 95, 175),
+            qRgb(0, 95, 215),
+            qRgb(0, 95, 255),
+            qRgb(0, 135, 0),
+            qRgb(0, 135, 95),
+            qRgb(0, 135, 135),
+            qRgb(0, 135, 175),
+            qRgb(0, 135, 215),
+            qRgb(0, 135, 255),
+            qRgb(0, 175, 0),
+            qRgb(0, 175, 95),
+            qRgb(0, 175, 135),
+            qRgb(0, 175, 175),
+            qRgb(0, 175, 215),
+            qRgb(0, 175, 255),
+            qRgb(0, 215, 0),
+            qRgb(0, 215, 95),
+            qRgb(0, 215, 135),
+            qRgb(0, 215, 175),
+            qRgb(0, 215, 215),
+            qRgb(0, 215, 255),
+            qRgb(0, 255, 0),
+            qRgb(0, 255, 95),
+            qRgb(0, 255, 135),
+            qRgb(0, 255, 175),
+            qRgb(0, 255, 215),
+            qRgb(0, 255, 255),
+            qRgb(95, 0, 0),
+            qRgb(95, 0, 95),
+            qRgb(95, 0, 135),
+            qRgb(95, 0, 175),
+            qRgb(95, 0, 215),
+            qRgb(95, 0, 255),
+            qRgb(95, 95, 0),
+            qRgb(95, 95, 95),
+            qRgb(95, 95, 135),
+            qRgb(95, 95, 175),
+            qRgb(95, 95, 215),
+            qRgb(95, 95, 255),
+            qRgb(95, 135, 0),
+            qRgb(95, 135, 95),
+            qRgb(95, 135, 135),
+            qRgb(95, 135, 175),
+            qRgb(95, 135, 215),
+            qRgb(95, 135, 255),
+            qRgb(95, 175, 0),
+            qRgb(95, 175, 95),
+            qRgb(95, 175, 135),
+            qRgb(95, 175, 175),
+            qRgb(95, 175, 215),
+            qRgb(95, 175, 255),
+            qRgb(95, 215, 0),
+            qRgb(95, 215, 95),
+            qRgb(95, 215, 135),
+            qRgb(95, 215, 175),
+            qRgb(95, 215, 215),
+            qRgb(95, 215, 255),
+            qRgb(95, 255, 0),
+            qRgb(95, 255, 95),
+            qRgb(95, 255, 135),
+            qRgb(95, 255, 175),
+            qRgb(95, 255, 215),
+            qRgb(95, 255, 255),
+            qRgb(135, 0, 0),
+            qRgb(135, 0, 95),
+            qRgb(135, 0, 135),
+            qRgb(135, 0, 175),
+            qRgb(135, 0, 215),
+            qRgb(135, 0, 255),
+            qRgb(135, 95, 0),
+            qRgb(135, 95, 95),
+            qRgb(135, 95, 135),
+            qRgb(135, 95, 175),
+            qRgb(135, 95, 215),
+            qRgb(135, 95, 255),
+            qRgb(135, 135, 0),
+            qRgb(135, 135, 95),
+            qRgb(135, 135, 135),
+            qRgb(135, 135, 175),
+            qRgb(135, 135, 215),
+            qRgb(135, 135, 255),
+            qRgb(135, 175, 0),
+            qRgb(135, 175, 95),
+            qRgb(135, 175, 135),
+            qRgb(135, 175, 175),
+            qRgb(135, 175, 215),
+            qRgb(135, 175, 255),
+            qRgb(135, 215, 0),
+            qRgb(135, 215, 95),
+            qRgb(135, 215, 135),
+            qRgb(135, 215, 175),
+            qRgb(135, 215, 215),
+            qRgb(135, 215, 255),
+            qRgb(135, 255, 0),
+            qRgb(135, 255, 95),
+            qRgb(135, 255, 135),
+            qRgb(135, 255, 175),
+            qRgb(135, 255, 215),
+            qRgb(135, 255, 255),
+            qRgb(175, 0, 0),
+            qRgb(175, 0, 95),
+            qRgb(175, 0, 135),
+            qRgb(175, 0, 175),
+            qRgb(175, 0, 215),
+            qRgb(175, 0, 255),
+            qRgb(175, 95, 0),
+            qRgb(175, 95, 95),
+            qRgb(175, 95, 135),
+            qRgb(175, 95, 175),
+            qRgb(175, 95, 215),
+            qRgb(175, 95, 255),
+            qRgb(175, 135, 0),
+            qRgb(175, 135, 95),
+            qRgb(175, 135, 135),
+            qRgb(175, 135, 175),
+            qRgb(175, 135, 215),
+            qRgb(175, 135, 255),
+            qRgb(175, 175, 0),
+            qRgb(175, 175, 95),
+            qRgb(175, 175, 135),
+            qRgb(175, 175, 175),
+            qRgb(175, 175, 215),
+            qRgb(175, 175, 255),
+            qRgb(175, 215, 0),
+            qRgb(175, 215, 95),
+            qRgb(175, 215, 135),
+            qRgb(175, 215, 175),
+            qRgb(175, 215, 215),
+            qRgb(175, 215, 255),
+            qRgb(175, 255, 0),
+            qRgb(175, 255, 95),
+            qRgb(175, 255, 135),
+            qRgb(175, 255, 175),
+            qRgb(175, 255, 215),
+            qRgb(175, 255, 255),
+            qRgb(215, 0, 0),
+            qRgb(215, 0, 95),
+            qRgb(215, 0, 135),
+            qRgb(215, 0, 175),
+            qRgb(215, 0, 215),
+            qRgb(215, 0, 255),
+            qRgb(215, 95, 0),
+            qRgb(215, 95, 95),
+            qRgb(215, 95, 135),
+            qRgb(215, 95, 175),
+            qRgb(215, 95, 215),
+            qRgb(215, 95, 255),
+            qRgb(215, 135, 0),
+            qRgb(215, 135, 95),
+            qRgb(215, 135, 135),
+            qRgb(215, 135, 175),
+            qRgb(215, 135, 215),
+            qRgb(215, 135, 255),
+            qRgb(215, 175, 0),
+            qRgb(215, 175, 95),
+            qRgb(215, 175, 135),
+            qRgb(215, 175, 175),
+            qRgb(215, 175, 215),
+            qRgb(215, 175, 255),
+            qRgb(215, 215, 0),
+            qRgb(215, 215, 95),
+            qRgb(215, 215, 135),
+            qRgb(215, 215, 175),
+            qRgb(215, 215, 215),
+            qRgb(215, 215, 255),
+            qRgb(215, 255, 0),
+            qRgb(215, 255, 95),
+            qRgb(215, 255, 135),
+            qRgb(215, 255, 175),
+            qRgb(215, 255, 215),
+            qRgb(215, 255, 255),
+            qRgb(255, 0, 0),
+            qRgb(255, 0, 95),
+            qRgb(255, 0, 135),
+            qRgb(255, 0, 175),
+            qRgb(255, 0, 215),
+            qRgb(255, 0, 255),
+            qRgb(255, 95, 0),
+            qRgb(255, 95, 95),
+            qRgb(255, 95, 135),
+            qRgb(255, 95, 175),
+            qRgb(255, 95, 215),
+            qRgb(255, 95, 255),
+            qRgb(255, 135, 0),
+            qRgb(255, 135, 95),
+            qRgb(255, 135, 135),
+            qRgb(255, 135, 175),
+            qRgb(255, 135, 215),
+            qRgb(255, 135, 255),
+            qRgb(255, 175, 0),
+            qRgb(255, 175, 95),
+            qRgb(255, 175, 135),
+            qRgb(255, 175, 175),
+            qRgb(255, 175, 215),
+            qRgb(255, 175, 255),
+            qRgb(255, 215, 0),
+            qRgb(255, 215, 95),
+            qRgb(255, 215, 135),
+            qRgb(255, 215, 175),
+            qRgb(255, 215, 215),
+            qRgb(255, 215, 255),
+            qRgb(255, 255, 0),
+            qRgb(255, 255, 95),
+            qRgb(255, 255, 135),
+            qRgb(255, 255, 175),
+            qRgb(255, 255, 215),
+            qRgb(255, 255, 255),
+            qRgb(8, 8, 8),
+            qRgb(18, 18, 18),
+            qRgb(28, 28, 28),
+            qRgb(38, 38, 38),
+            qRgb(48, 48, 48),
+            qRgb(58, 58, 58),
+            qRgb(68, 68, 68),
+            qRgb(78, 78, 78),
+            qRgb(88, 88, 88),
+            qRgb(98, 98, 98),
+            qRgb(108, 108, 108),
+            qRgb(118, 118, 118),
+            qRgb(128, 128, 128),
+            qRgb(138, 138, 138),
+            qRgb(148, 148, 148),
+            qRgb(158, 158, 158),
+            qRgb(168, 168, 168),
+            qRgb(178, 178, 178),
+            qRgb(188, 188, 188),
+            qRgb(198, 198, 198),
+            qRgb(208, 208, 208),
+            qRgb(218, 218, 218),
+            qRgb(228, 228, 228),
+            qRgb(238, 238, 238),
             // Default colors
-            QColor(255, 255, 255),
-            QColor(85, 85, 85),
-            QColor(200, 200, 200),        // Default font color
-            QColor(24, 24, 24)            // Default background color
+            qRgb(255, 255, 255),
+            qRgb(85, 85, 85),
+            qRgb(200, 200, 200),          // Default font color
+            qRgb(24, 24, 24)              // Default background color
     };
 };
 
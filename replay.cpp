@@ -0,0 +1,122 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#include "replay.h"
+
+PtyReplay::PtyReplay(SimpleTerminal *terminal, QObject *parent) : QObject(parent), terminal(terminal) {
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, this, [this]() {
+        apply();
+        playNext();
+    });
+}
+
+PtyReplay::~PtyReplay() {
+    stop();
+}
+
+bool PtyReplay::open(const QString &path) {
+    stop();
+    file.setFileName(path);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit s_error("Could not open recording " + path + ".");
+        return false;
+    }
+
+    stream.setDevice(&file);
+
+    quint32 fileMagic;
+    quint16 fileVersion;
+    stream >> fileMagic >> fileVersion >> cols >> rows;
+
+    if (stream.status() != QDataStream::Ok || fileMagic != magic || fileVersion != version) {
+        emit s_error("Not a supported recording: " + path + ".");
+        stop();
+        return false;
+    }
+
+    // start from the recorded screen size
+    terminal->tresize(cols, rows);
+    return true;
+}
+
+void PtyReplay::play(double speed) {
+    this->speed = speed > 0 ? speed : 1.0;
+    dueUs = 0;
+    clock.start();
+    playNext();
+}
+
+qint64 PtyReplay::runToEnd() {
+    qint64 bytes = 0;
+    timer.stop();
+
+    while (readRecord()) {
+        bytes += apply();
+    }
+
+    emit s_finished();
+    return bytes;
+}
+
+void PtyReplay::stop() {
+    timer.stop();
+    stream.setDevice(nullptr);
+    file.close();
+}
+
+bool PtyReplay::readRecord() {
+    if (!file.isOpen() || stream.atEnd()) {
+        return false;
+    }
+
+    stream >> type >> delayUs;
+
+    if (type == RecordData) {
+        quint32 len;
+        stream >> len;
+        data.resize(len);
+        if (stream.readRawData(data.data(), len) != (int) len) {
+            stream.setStatus(QDataStream::ReadPastEnd);
+        }
+    } else if (type == RecordResize) {
+        stream >> cols >> rows;
+    } else {
+        stream.setStatus(QDataStream::ReadCorruptData);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        emit s_error("Recording is truncated or corrupt.");
+        stop();
+        return false;
+    }
+    return true;
+}
+
+/*
+ * Applies the current record, returns the number of bytes fed
+ */
+qint64 PtyReplay::apply() {
+    if (type == RecordResize) {
+        terminal->tresize(cols, rows);
+        return 0;
+    }
+
+    terminal->feed(data.constData(), data.size());
+    return data.size();
+}
+
+void PtyReplay::playNext() {
+    if (!readRecord()) {
+        emit s_finished();
+        return;
+    }
+
+    // scheduled against the start of play, so the timer latency does not add up over the records
+    dueUs += delayUs;
+    qint64 remainingUs = (qint64) (dueUs / speed) - clock.nsecsElapsed() / 1000;
+    timer.start((int) qMax<qint64>(0, remainingUs / 1000));
+}
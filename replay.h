@@ -0,0 +1,83 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <QObject>
+#include <QFile>
+#include <QDataStream>
+#include <QByteArray>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "st.h"
+
+/*
+ * Replays a recording of SimpleTerminal::startRecording into a terminal
+ * The recorded chunks are fed through SimpleTerminal::feed unchanged, the same path as tty output, so a replay always
+ * produces the same screen state and damage.
+ *
+ * File format (QDataStream): magic, version, cols, rows followed by records of
+ * type (quint8), time since the previous record in us (quint64) and
+ *   RecordData:   length (quint32), bytes
+ *   RecordResize: cols (quint16), rows (quint16)
+ */
+class PtyReplay : public QObject {
+    Q_OBJECT
+public:
+    static const quint32 magic = 0x514c5452; // "QLTR"
+    static const quint16 version = 2;
+
+    enum RecordType : quint8 {
+        RecordData = 0,
+        RecordResize = 1
+    };
+
+    explicit PtyReplay(SimpleTerminal *terminal, QObject *parent = nullptr);
+
+    ~PtyReplay();
+
+    bool open(const QString &path);
+
+    /*
+     * Plays the recording asynchronously with the recorded timing divided by speed
+     */
+    void play(double speed = 1.0);
+
+    /*
+     * Feeds all remaining records as fast as possible, returns the number of bytes fed
+     */
+    qint64 runToEnd();
+
+    void stop();
+
+    signals:
+            void s_finished();
+
+    void s_error(QString);
+
+private:
+    SimpleTerminal *terminal;
+    QFile file;
+    QDataStream stream;
+    QTimer timer;
+    QElapsedTimer clock; // started by play, the records are due relative to it
+    double speed = 1.0;
+    qint64 dueUs = 0;    // recorded time of the next record since the start of play
+
+    // the next record
+    quint8 type;
+    quint64 delayUs;
+    QByteArray data;
+    quint16 cols, rows;
+
+    bool readRecord();
+
+    qint64 apply();
+
+    void playNext();
+};
+
+#endif // REPLAY_H
@@ -0,0 +1,231 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#include "shellpool.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    ShellPool *sharedPool = nullptr;
+
+    bool sameCommand(const ShellCommand &a, const ShellCommand &b) {
+        return a.program == b.program && a.arguments == b.arguments && a.environment == b.environment;
+    }
+
+    /*
+     * Collects the shell if it exited. If the child was reaped elsewhere or SIGCHLD is ignored, waitpid fails with
+     * ECHILD and only kill tells whether the process still runs.
+     */
+    bool exited(pid_t pid) {
+        pid_t ret;
+
+        if (pid <= 0) {
+            return true;
+        }
+
+        do {
+            ret = ::waitpid(pid, nullptr, WNOHANG);
+        } while (ret < 0 && errno == EINTR);
+
+        if (ret >= 0) {
+            return ret == pid;
+        }
+        return errno == ECHILD && ::kill(pid, 0) < 0 && errno == ESRCH;
+    }
+}
+
+ShellPool::ShellPool(int size, const ShellCommand &command, QObject *parent) : QObject(parent), shellCommand(command),
+                                                                               size(qMax(0, size)) {
+    spawned.master = -1;
+
+    refillTimer.setInterval(0);
+    connect(&refillTimer, &QTimer::timeout, this, &ShellPool::refill);
+
+    connect(&reapTimer, &QTimer::timeout, this, &ShellPool::reap);
+    reapTimer.start(30 * 1000);
+
+    refillTimer.start();
+}
+
+ShellPool::~ShellPool() {
+    if (sharedPool == this) {
+        sharedPool = nullptr;
+    }
+
+    // the spawn takes milliseconds, its shell is hung up with the idle ones
+    if (spawner) {
+        spawner->wait();
+        delete spawner;
+        spawner = nullptr;
+
+        if (spawned.master > -1) {
+            ::close(spawned.master);
+            ::kill(spawned.pid, SIGHUP);
+            closing.append(spawned.pid);
+        }
+    }
+
+    for (const Entry &entry: idle) {
+        discard(entry);
+    }
+    idle.clear();
+    reap();
+}
+
+void ShellPool::setDefault(ShellPool *pool) {
+    sharedPool = pool;
+}
+
+ShellPool *ShellPool::defaultPool() {
+    return sharedPool;
+}
+
+PtyTransport *ShellPool::adopt(const ShellCommand &command) {
+    if (sharedPool && sameCommand(sharedPool->command(), command)) {
+        PtyTransport *transport = sharedPool->take();
+        if (transport) {
+            return transport;
+        }
+    }
+    return new PtyTransport();
+}
+
+void ShellPool::setSize(int size) {
+    this->size = qMax(0, size);
+
+    while (idle.size() > this->size) {
+        discard(idle.takeLast());
+    }
+    refillTimer.start();
+}
+
+void ShellPool::setTerminalSize(int cols, int rows, int width, int height) {
+    this->cols = cols;
+    this->rows = rows;
+    this->width = width;
+    this->height = height;
+
+    for (const Entry &entry: idle) {
+        entry.transport->resize(cols, rows, width, height);
+    }
+}
+
+void ShellPool::setMaxAge(int ms) {
+    maxAge = ms;
+}
+
+PtyTransport *ShellPool::take() {
+    refillTimer.start();
+
+    // the shell may have exited since the last reap, e.g. killed from outside
+    while (!idle.isEmpty()) {
+        PtyTransport *transport = idle.takeFirst().transport;
+
+        if (exited(transport->pid())) {
+            delete transport;
+            continue;
+        }
+
+        transport->setParent(nullptr);
+        transport->setReadEnabled(true);
+        return transport;
+    }
+    return nullptr;
+}
+
+/*
+ * Opens the next shell on a worker thread, openpty and the spawn must not stall the event loop
+ */
+void ShellPool::refill() {
+    refillTimer.stop();
+
+    if (spawner || idle.size() >= size) {
+        return;
+    }
+
+    ShellCommand command = shellCommand;
+    struct winsize wsize = {(unsigned short) rows, (unsigned short) cols, (unsigned short) width,
+                            (unsigned short) height};
+
+    spawner = QThread::create([this, command, wsize]() {
+        spawned = PtyTransport::spawn(command, wsize);
+    });
+    spawner->setObjectName("QLightTerminal shell pool");
+    connect(spawner, &QThread::finished, this, &ShellPool::adoptSpawned);
+    spawner->start();
+}
+
+/*
+ * Wraps the shell opened by the worker into a transport, runs on the thread of the pool
+ */
+void ShellPool::adoptSpawned() {
+    spawner->wait();
+    delete spawner;
+    spawner = nullptr;
+
+    if (spawned.master < 0) {
+        // do not retry in a loop, the next take tries again
+        return;
+    }
+
+    auto *transport = new PtyTransport(this);
+    transport->adopt(spawned);
+    spawned.master = -1;
+
+    // the terminal size may have changed during the spawn
+    transport->resize(cols, rows, width, height);
+
+    // the output stays in the pty until a terminal adopts the shell
+    transport->setReadEnabled(false);
+
+    Entry entry{transport, QElapsedTimer()};
+    entry.age.start();
+    idle.append(entry);
+
+    // the size may have shrunk during the spawn as well
+    while (idle.size() > size) {
+        discard(idle.takeLast());
+    }
+    refillTimer.start();
+}
+
+/*
+ * Replaces shells that exited or are older than maxAge and collects hung up ones
+ */
+void ShellPool::reap() {
+    for (int i = idle.size() - 1; i >= 0; i--) {
+        const Entry &entry = idle[i];
+
+        if (exited(entry.transport->pid())) {
+            delete entry.transport;
+            idle.removeAt(i);
+        } else if (entry.age.hasExpired(maxAge)) {
+            discard(idle.takeAt(i));
+        }
+    }
+
+    for (int i = closing.size() - 1; i >= 0; i--) {
+        if (exited(closing[i])) {
+            closing.removeAt(i);
+        }
+    }
+
+    if (idle.size() < size) {
+        refillTimer.start();
+    }
+}
+
+void ShellPool::discard(const Entry &entry) {
+    pid_t pid = entry.transport->pid();
+
+    // closing the master hangs up the shell
+    delete entry.transport;
+    if (pid > 0) {
+        ::kill(pid, SIGHUP);
+        closing.append(pid);
+    }
+}
@@ -0,0 +1,82 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#ifndef SHELLPOOL_H
+#define SHELLPOOL_H
+
+#include <QObject>
+#include <QList>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include "transport.h"
+
+/*
+ * Pool of pre-spawned shells on pre-sized ptys (opt-in)
+ * A new terminal adopts a running shell instead of waiting for openpty, the spawn and the rc files. The pool refills
+ * itself one shell at a time on a worker thread, stays bounded by its size and replaces shells that exited or got
+ * stale.
+ */
+class ShellPool : public QObject {
+    Q_OBJECT
+public:
+    explicit ShellPool(int size = 2, const ShellCommand &command = ShellCommand(), QObject *parent = nullptr);
+
+    ~ShellPool();
+
+    /*
+     * Pool used by new terminals started with the same command, nullptr to disable
+     */
+    static void setDefault(ShellPool *pool);
+
+    static ShellPool *defaultPool();
+
+    /*
+     * Takes a shell of the default pool if it runs the command, otherwise returns a new unopened transport
+     */
+    static PtyTransport *adopt(const ShellCommand &command);
+
+    void setSize(int size);
+
+    void setTerminalSize(int cols, int rows, int width, int height);
+
+    void setMaxAge(int ms); // shells idle for longer are replaced (10 min by default)
+
+    /*
+     * Hands out a running shell, nullptr if the pool is empty
+     */
+    PtyTransport *take();
+
+    int available() const { return idle.size(); }
+
+    const ShellCommand &command() const { return shellCommand; }
+
+private:
+    typedef struct {
+        PtyTransport *transport;
+        QElapsedTimer age;
+    } Entry;
+
+    ShellCommand shellCommand;
+    QList<Entry> idle;
+    QList<pid_t> closing; // shells that were hung up but not yet reaped
+    QTimer refillTimer;
+    QTimer reapTimer;
+    QThread *spawner = nullptr;    // worker opening the next shell
+    PtyTransport::Spawned spawned; // its result, read once the worker finished
+    int size;
+    int maxAge = 10 * 60 * 1000;
+    int cols = 80, rows = 24, width = 0, height = 0;
+
+    void refill();
+
+    void adoptSpawned();
+
+    void reap();
+
+    void discard(const Entry &entry);
+};
+
+#endif // SHELLPOOL_H
@@ -106,6 +106,7 @@ enum term_mode {
     MODE_ECHO = 1 << 4,
     MODE_PRINT = 1 << 5,
     MODE_UTF8 = 1 << 6,
+    MODE_SYNC = 1 << 7,
 };
 
 enum cursor_movement {
@@ -169,6 +170,8 @@ typedef struct {
     int altHisti; /* alt screen history index */
     int altScr;   /* alt screen scrollback */
     int *dirty;   /* dirtyness of lines */
+    int *blink;   /* number of blinking cells of each line */
+    int *altBlink; /* same for the alternate screen */
     TCursor c;    /* cursor */
     int ocx;      /* old cursor col */
     int ocy;      /* old cursor row */
@@ -243,6 +246,26 @@ enum win_mode {
  | MODE_MOUSEMANY,
 };
 
+/* Performance counters, totals since the terminal was created */
+typedef struct {
+    uint64_t bytesRead; /* bytes read from the tty */
+    uint64_t reads;     /* number of reads from the tty */
+    uint64_t parseNs;   /* time spent in twrite (only measured if enabled) */
+    uint64_t escapes;   /* escape sequences handled */
+    uint64_t lastWriteNs; /* time of the last ttywrite (Trace::now, only measured if enabled) */
+    uint64_t lastReadNs;  /* time of the last ttyread (Trace::now, only measured if enabled) */
+    uint64_t spawnNs;     /* time to open the pty and start the shell */
+    uint64_t readPauses;  /* times reading was paused by backpressure */
+    uint64_t pausedNs;    /* time reading was paused */
+} TermStats;
+
+/* Flow control between reading, parsing and painting, a limit of 0 disables the check */
+typedef struct {
+    int64_t maxPendingBytes;   /* pause reading above this many read but unparsed bytes */
+    int64_t maxUnpaintedBytes; /* pause reading above this many parsed but unpainted bytes */
+    int maxPauseMs;            /* reading resumes after this time at the latest */
+} Backpressure;
+
 /* Purely graphic info */
 typedef struct {
     int tw, th; /* tty width and height */
@@ -1,40 +1,59 @@
 #include "st.h"
+#include "trace.h"
+#include "replay.h"
+#include "shellpool.h"
 #include <stdio.h>
 #include <sys/stat.h>
 #include <unistd.h>
-#include <pwd.h>
 #include <signal.h>
 #include <stdlib.h>
+#include <poll.h>
 
 #include <QString>
-#include <QApplication>
+#include <QElapsedTimer>
 
-#if   defined(__linux)
-#include <pty.h>
-#elif defined(__OpenBSD__) || defined(__NetBSD__) || defined(__APPLE__)
-#include <util.h>
-#elif defined(__FreeBSD__) || defined(__DragonFly__)
-#include <libutil.h>
-#endif
+SimpleTerminal::SimpleTerminal(QObject *parent) : SimpleTerminal(ShellCommand(), parent) {}
 
-SimpleTerminal::SimpleTerminal(QObject *parent) : QObject(parent) {
-    readBufSize = sizeof(readBuf) / sizeof(readBuf[0]);
-
-    tnew(80, 80);
-    ttynew();
+SimpleTerminal::SimpleTerminal(const ShellCommand &command, QObject *parent)
+        : SimpleTerminal(ShellPool::adopt(command), parent) {
+    auto *pty = static_cast<PtyTransport *>(transport);
 
-    readNotifier = new QSocketNotifier(master, QSocketNotifier::Read);
-    readNotifier->setEnabled(true);
+    if (pty->pid() < 0) {
+        pty->open(command);
+    } else {
+        // a pre-spawned shell of the pool, show its prompt right away
+        ttydrain();
+    }
+    stats.spawnNs = pty->spawnNs();
+}
 
-    connect(readNotifier, &QSocketNotifier::activated, this, &SimpleTerminal::ttyread);
+SimpleTerminal::SimpleTerminal(Transport *transport, QObject *parent) : QObject(parent) {
+    readBufSize = sizeof(readBuf) / sizeof(readBuf[0]);
+    stats = TermStats{};
 
     // Fix for Zorin OS (error: invalid old space)
     // Needed since we only call realloc later
     strescseq.buf = (char *) malloc(STR_BUF_SIZ);
+
+    tnew(80, 80);
+    setTransport(transport);
+
+    // reading resumes after the maximum pause even if nothing was painted
+    pauseTimer.setSingleShot(true);
+    connect(&pauseTimer, &QTimer::timeout, this, &SimpleTerminal::resumeReading);
+
+    // the next parse slice runs once pending events were handled
+    sliceTimer.setSingleShot(true);
+    sliceTimer.setInterval(0);
+    connect(&sliceTimer, &QTimer::timeout, this, &SimpleTerminal::parseSlice);
+
+    // a synchronized update that is never finished must not freeze the view
+    syncTimer.setSingleShot(true);
+    connect(&syncTimer, &QTimer::timeout, this, &SimpleTerminal::endSync);
 }
 
 SimpleTerminal::~SimpleTerminal() {
-    disconnect(readNotifier);
+    disconnect(transport, nullptr, this, nullptr);
 
     for (int i = 0; i <= term.row; i++) {
         free(term.line[i]);
@@ -42,10 +61,21 @@ SimpleTerminal::~SimpleTerminal() {
     }
 
     free(term.dirty);
+    free(term.blink);
+    free(term.altBlink);
     free(term.tabs);
     free(strescseq.buf);
 
-    delete readNotifier;
+    stopRecording();
+}
+
+void SimpleTerminal::setTransport(Transport *transport) {
+    this->transport = transport;
+    transport->setParent(this);
+
+    connect(transport, &Transport::s_readyRead, this, &SimpleTerminal::ttyread);
+    connect(transport, &Transport::s_closed, this, &SimpleTerminal::s_closed);
+    connect(transport, &Transport::s_error, this, &SimpleTerminal::s_error);
 }
 
 void SimpleTerminal::tnew(int col, int row) {
@@ -55,111 +85,15 @@ void SimpleTerminal::tnew(int col, int row) {
 }
 
 void SimpleTerminal::closePty() {
-    if (slave > 1) {
-        ::close(slave);
-        slave = -1;
-    }
-
-    if (master > -1) {
-        ::close(master);
-        master = -1;
-    }
-
-    emit s_closed();
-}
-
-void SimpleTerminal::ttynew() {
-    master = -1;
-    slave = -1;
-
-    /* seems to work fine on linux, openbsd and freebsd */
-    if (::openpty(&master, &slave, NULL, NULL, NULL) < 0) {
-        emit s_error("Could not open new file descriptor.");
-        return;
-    }
-
-    switch (processId = fork()) {
-        case -1:
-            closePty();
-            emit s_error("Could not fork process.");
-            return;
-            break;
-        case 0:
-            ::close(master);
-            ::setsid(); /* create a new process group */
-            ::dup2(slave, 0);
-            ::dup2(slave, 1);
-            ::dup2(slave, 2);
-            if (::ioctl(slave, TIOCSCTTY, NULL) < 0) {
-                closePty();
-                emit s_error("Error setting the controlling terminal.");
-                return;
-            }
-            if (slave > 2)
-                ::close(slave);
-#ifdef __OpenBSD__
-            if (::pledge("stdio getpw proc exec", NULL) == -1){
-                closePty();
-                emit s_error("Error on pledge.");
-                return;
-            }
-#endif
-            execsh();
-            break;
-        default:
-#ifdef __OpenBSD__
-            if (::pledge("stdio rpath tty proc", NULL) == -1){
-                closePty();
-                emit s_error("Error on pledge.");
-                return;
-            }
-#endif
-            ::close(slave);
-            break;
-    }
-}
-
-void SimpleTerminal::execsh() {
-    const struct passwd *pw;
-
-    errno = 0;
-    if ((pw = ::getpwuid(getuid())) == NULL) {
-        if (errno) {
-            closePty();
-            emit s_error("Error on getpwuid.");
-            return;
-        } else {
-            closePty();
-            emit s_error("Could not retrive user identity.");
-            return;
-        }
-    }
-
-    QByteArray shell = qgetenv("SHELL");
-    if (shell.size() == 0) {
-        shell = (pw->pw_shell[0]) ? pw->pw_shell : "/bin/sh";
-    }
-
-    ::unsetenv("COLUMNS");
-    ::unsetenv("LINES");
-    ::unsetenv("TERMCAP");
-    ::setenv("LOGNAME", pw->pw_name, 1);
-    ::setenv("USER", pw->pw_name, 1);
-    ::setenv("SHELL", shell, 1);
-    ::setenv("HOME", pw->pw_dir, 1);
-    // TODO figure out a way to use tic command with custom term info file
-    ::setenv("TERM", "xterm-256color", 1);
-
-    char *args[] = {shell.data(), NULL, NULL};
-
-    ::execvp(shell.constData(), args);
+    transport->close();
 }
 
 size_t SimpleTerminal::ttyread() {
+    TraceScope trace("ttyread");
     int ret, written;
 
     /* append read bytes to unprocessed bytes */
-    ret = ::read(master, readBuf + readBufPos, readBufSize - readBufPos);
+    ret = transport->read(readBuf + readBufPos, readBufSize - readBufPos);
 
     switch (ret) {
         case 0:
@@ -169,15 +103,46 @@ size_t SimpleTerminal::ttyread() {
             emit s_error("Could not read from shell.");
             return 0;
         default:
+            if (recordFile) {
+                recordHeader(PtyReplay::RecordData);
+                recordStream << (quint32) ret;
+                recordStream.writeRawData(readBuf + readBufPos, ret);
+            }
+
+            stats.bytesRead += ret;
+            stats.reads++;
+
+            if (statsEnabled) {
+                stats.lastReadNs = Trace::now();
+            }
+
+            /* parse in slices, everything not parsed yet waits in pendingInput */
+            if (sliced()) {
+                pendingInput.append(readBuf, ret);
+                parseSlice();
+                return ret;
+            }
+
             readBufPos += ret;
-            written = twrite(readBuf, readBufPos, 0);
+
+            if (statsEnabled) {
+                QElapsedTimer parseTimer;
+                parseTimer.start();
+                written = twrite(readBuf, readBufPos, 0);
+                stats.parseNs += parseTimer.nsecsElapsed();
+            } else {
+                written = twrite(readBuf, readBufPos, 0);
+            }
             readBufPos -= written;
             /* keep any incomplete UTF-8 byte sequence for the next call */
             if (readBufPos > 0) {
                 ::memmove(readBuf, readBuf + written, readBufPos);
             }
 
-            emit s_updateView(&term);
+            unpaintedBytes += written;
+            checkBackpressure();
+
+            emitDamage();
             return ret;
     }
 }
@@ -194,6 +159,11 @@ void SimpleTerminal::tresize(int col, int row) {
         return;
     }
 
+    if (recordFile) {
+        recordHeader(PtyReplay::RecordResize);
+        recordStream << (quint16) col << (quint16) row;
+    }
+
     /*
      * slide screen to keep cursor where we expect it -
      * tscrollup would work here, but we can optimize to
@@ -217,9 +187,12 @@ void SimpleTerminal::tresize(int col, int row) {
     term.line = (Line *) realloc(term.line, row * sizeof(Line));
     term.alt = (Line *) realloc(term.alt, row * sizeof(Line));
     term.dirty = (int *) realloc(term.dirty, row * sizeof(*term.dirty));
+    term.blink = (int *) realloc(term.blink, row * sizeof(*term.blink));
+    term.altBlink = (int *) realloc(term.altBlink, row * sizeof(*term.altBlink));
     term.tabs = (int *) realloc(term.tabs, col * sizeof(*term.tabs));
 
-    if (term.line == NULL || term.alt == NULL || term.dirty == NULL || term.tabs == NULL) {
+    if (term.line == NULL || term.alt == NULL || term.dirty == NULL || term.blink == NULL || term.altBlink == NULL
+        || term.tabs == NULL) {
         emit s_error("Error on resize");
         return;
     }
@@ -289,6 +262,12 @@ void SimpleTerminal::tresize(int col, int row) {
         tcursor(CURSOR_LOAD);
     }
     term.c = c;
+
+    /* lines were moved and cut, count the blinking cells again */
+    for (i = 0; i < row; i++) {
+        term.blink[i] = tcountblink(term.line[i]);
+        term.altBlink[i] = tcountblink(term.alt[i]);
+    }
 }
 
 
@@ -395,6 +374,7 @@ void SimpleTerminal::tputc(Rune u) {
             if (!eschandle(u))
                 return;
             /* sequence already finished */
+            stats.escapes++;
         }
         term.esc = 0;
         /*
@@ -436,6 +416,8 @@ void SimpleTerminal::tputc(Rune u) {
                 gp[2].u = ' ';
                 gp[2].mode &= ~ATTR_WDUMMY;
             }
+            if (gp[1].mode & ATTR_BLINK)
+                term.blink[term.c.y]--;
             gp[1].u = '\0';
             gp[1].mode = ATTR_WDUMMY;
         }
@@ -448,6 +430,7 @@ void SimpleTerminal::tputc(Rune u) {
 }
 
 int SimpleTerminal::twrite(const char *buf, int size, int show_ctrl) {
+    TraceScope trace("twrite");
     int charsize;
     Rune u;
     int n;
@@ -480,6 +463,10 @@ int SimpleTerminal::twrite(const char *buf, int size, int show_ctrl) {
 void SimpleTerminal::ttywrite(const char *s, size_t n, int may_echo) {
     const char *next;
 
+    if (statsEnabled) {
+        stats.lastWriteNs = Trace::now();
+    }
+
     kscrolldown(term.scr);
 
     if (may_echo && IS_SET(term.mode, MODE_ECHO))
@@ -509,6 +496,16 @@ void SimpleTerminal::ttywriteraw(const char *s, size_t n) {
     fd_set wfd, rfd;
     ssize_t r;
     size_t lim = 256;
+    int wfdno = transport->writeDescriptor();
+    int rfdno = transport->readDescriptor();
+
+    /* nothing to wait for, e.g. an in-memory transport */
+    if (wfdno < 0) {
+        if (transport->write(s, n) < 0) {
+            emit s_error("Error on write in ttywriteraw.");
+        }
+        return;
+    }
 
     /*
      * Remember that we are using a pty, which might be a modem line.
@@ -519,24 +516,26 @@ void SimpleTerminal::ttywriteraw(const char *s, size_t n) {
     while (n > 0) {
         FD_ZERO(&wfd);
         FD_ZERO(&rfd);
-        FD_SET(master, &wfd);
-        FD_SET(master, &rfd);
+        FD_SET(wfdno, &wfd);
+        /* the input is drained while waiting, the child may block on writing to us */
+        if (rfdno >= 0)
+            FD_SET(rfdno, &rfd);
 
         /* Check if we can write. */
-        if (pselect(master + 1, &rfd, &wfd, NULL, NULL, NULL) < 0) {
+        if (pselect(MAX(wfdno, rfdno) + 1, &rfd, &wfd, NULL, NULL, NULL) < 0) {
             if (errno == EINTR) {
                 continue;
             }
             emit s_error("Pselect failed in ttywriteraw");
             return;
         }
-        if (FD_ISSET(master, &wfd)) {
+        if (FD_ISSET(wfdno, &wfd)) {
             /*
              * Only write the bytes written by ttywrite() or the
              * default of 256. This seems to be a reasonable value
              * for a serial line. Bigger values might clog the I/O.
              */
-            if ((r = write(master, s, (n < lim) ? n : lim)) < 0) {
+            if ((r = transport->write(s, (n < lim) ? n : lim)) < 0) {
                 emit s_error("Error on write in ttywriteraw.");
                 return;
             }
@@ -547,7 +546,7 @@ void SimpleTerminal::ttywriteraw(const char *s, size_t n) {
                  * again. Empty it.
                  */
                 if (n < lim)
-                    lim = ttyread();
+                    lim = ttyreadlimit(lim);
                 n -= r;
                 s += r;
             } else {
@@ -555,13 +554,39 @@ void SimpleTerminal::ttywriteraw(const char *s, size_t n) {
                 break;
             }
         }
-        if (FD_ISSET(master, &rfd))
-            lim = ttyread();
+        if (rfdno >= 0 && FD_ISSET(rfdno, &rfd))
+            lim = ttyreadlimit(lim);
     }
     return;
 }
 
 
+/*
+ * Parses everything the transport has ready right now without waiting for more
+ */
+void SimpleTerminal::ttydrain() {
+    int fd = transport->readDescriptor();
+    struct pollfd pfd = {fd, POLLIN, 0};
+
+    for (;;) {
+        bool ready = fd >= 0 && ::poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+        if (!ready && transport->bytesAvailable() == 0) {
+            break;
+        }
+        if (ttyread() == 0) {
+            break;
+        }
+    }
+}
+
+/*
+ * Drains the tty while writing, keeps the previous limit if nothing could be read (non-blocking transports)
+ */
+size_t SimpleTerminal::ttyreadlimit(size_t lim) {
+    size_t n = ttyread();
+    return n > 0 ? n : lim;
+}
+
 size_t SimpleTerminal::utf8decode(const char *c, Rune *u, size_t clen) {
     size_t i, j, len, type;
     Rune udecoded;
@@ -815,6 +840,8 @@ void SimpleTerminal::tclearregion(int x1, int y1, int x2, int y2) {
             gp = &term.line[y][x];
             if (selected(x, y))
                 selclear();
+            if (gp->mode & ATTR_BLINK)
+                term.blink[y]--;
             gp->fg = term.c.attr.fg;
             gp->bg = term.c.attr.bg;
             gp->mode = 0;
@@ -891,6 +918,7 @@ void SimpleTerminal::tsetdirt(int top, int bot) {
 }
 
 void SimpleTerminal::strhandle(void) {
+    TraceScope trace("strhandle", strescseq.buf, strescseq.len);
     char *p = NULL, *dec;
     int j, narg, par;
     const struct { unsigned int idx; char *str; } osc_table[] = {
@@ -899,6 +927,7 @@ void SimpleTerminal::strhandle(void) {
 		{ defaultcs, "cursor" }
 	};
 
+    stats.escapes++;
     term.esc &= ~(ESC_STR_END | ESC_STR);
     strparse();
     par = (narg = strescseq.narg) ? atoi(strescseq.args[0]) : 0;
@@ -1053,11 +1082,34 @@ void SimpleTerminal::tsetchar(Rune u, const Glyph *attr, int x, int y) {
         term.line[y][x - 1].mode &= ~ATTR_WIDE;
     }
 
+    if (term.line[y][x].mode & ATTR_BLINK)
+        term.blink[y]--;
+    if (attr->mode & ATTR_BLINK)
+        term.blink[y]++;
+
     term.dirty[y] = 1;
     term.line[y][x] = *attr;
     term.line[y][x].u = u;
 }
 
+int SimpleTerminal::tcountblink(const Glyph *line) const {
+    int x, n = 0;
+
+    for (x = 0; x < term.col; x++) {
+        if (line[x].mode & ATTR_BLINK)
+            n++;
+    }
+    return n;
+}
+
+bool SimpleTerminal::blinking() const {
+    for (int y = 0; y < term.row; y++) {
+        if (term.blink[y] > 0)
+            return true;
+    }
+    return false;
+}
+
 void SimpleTerminal::csireset(void) {
     memset(&csiescseq, 0, sizeof(csiescseq));
 }
@@ -1094,9 +1146,12 @@ void SimpleTerminal::csiparse(void) {
 }
 
 void SimpleTerminal::csihandle(void) {
+    TraceScope trace("csihandle", csiescseq.buf, csiescseq.len);
     char buf[40];
     int len;
 
+    stats.escapes++;
+
     switch (csiescseq.mode[0]) {
         default:
         unknown:
@@ -1302,6 +1357,17 @@ void SimpleTerminal::csihandle(void) {
         case 'u': /* DECRC -- Restore cursor position (ANSI.SYS) */
             tcursor(CURSOR_LOAD);
             break;
+        case '$':
+            switch (csiescseq.mode[1]) {
+                case 'p': /* DECRQM -- Request Mode */
+                    len = snprintf(buf, sizeof(buf), "\033[%s%d;%d$y", csiescseq.priv ? "?" : "",
+                                   csiescseq.arg[0], tmodestate(csiescseq.priv, csiescseq.arg[0]));
+                    ttywrite(buf, len, 0);
+                    break;
+                default:
+                    goto unknown;
+            }
+            break;
         case ' ':
             switch (csiescseq.mode[1]) {
                 case 'q': /* DECSCUSR -- Set Cursor Style */
@@ -1409,6 +1475,7 @@ void SimpleTerminal::tinsertblank(int n) {
 
     memmove(&line[dst], &line[src], size * sizeof(Glyph));
     tclearregion(src, term.c.y, dst - 1, term.c.y);
+    term.blink[term.c.y] = tcountblink(line);
 }
 
 void SimpleTerminal::tinsertblankline(int n) {
@@ -1442,7 +1509,7 @@ void SimpleTerminal::kscrollup(int n) {
 }
 
 void SimpleTerminal::tscrolldown(int orig, int n, int copyhist) {
-    int i;
+    int i, count;
     Line temp;
 
     LIMIT(n, 0, term.bot - orig + 1);
@@ -1452,6 +1519,7 @@ void SimpleTerminal::tscrolldown(int orig, int n, int copyhist) {
         temp = term.hist[term.histi];
         term.hist[term.histi] = term.line[term.bot];
         term.line[term.bot] = temp;
+        term.blink[term.bot] = tcountblink(temp);
     }
 
     tsetdirt(orig, term.bot - n);
@@ -1461,6 +1529,9 @@ void SimpleTerminal::tscrolldown(int orig, int n, int copyhist) {
         temp = term.line[i];
         term.line[i] = term.line[i - n];
         term.line[i - n] = temp;
+        count = term.blink[i];
+        term.blink[i] = term.blink[i - n];
+        term.blink[i - n] = count;
     }
 
     if (term.scr == 0)
@@ -1468,7 +1539,7 @@ void SimpleTerminal::tscrolldown(int orig, int n, int copyhist) {
 }
 
 void SimpleTerminal::tscrollup(int orig, int n, int copyhist) {
-    int i;
+    int i, count;
     Line temp;
 
     LIMIT(n, 0, term.bot - orig + 1);
@@ -1478,6 +1549,7 @@ void SimpleTerminal::tscrollup(int orig, int n, int copyhist) {
         temp = term.hist[term.histi];
         term.hist[term.histi] = term.line[orig];
         term.line[orig] = temp;
+        term.blink[orig] = tcountblink(temp);
     }
 
     if (term.scr > 0 && term.scr < HISTSIZE)
@@ -1490,6 +1562,9 @@ void SimpleTerminal::tscrollup(int orig, int n, int copyhist) {
         temp = term.line[i];
         term.line[i] = term.line[i + n];
         term.line[i + n] = temp;
+        count = term.blink[i];
+        term.blink[i] = term.blink[i + n];
+        term.blink[i + n] = count;
     }
 
     if (term.scr == 0)
@@ -1514,6 +1589,7 @@ void SimpleTerminal::tdeletechar(int n) {
 
     memmove(&line[dst], &line[src], size * sizeof(Glyph));
     tclearregion(term.col - n, term.c.y, term.col - 1, term.c.y);
+    term.blink[term.c.y] = tcountblink(line);
 }
 
 void SimpleTerminal::tdeftran(char ascii) {
@@ -1668,6 +1744,9 @@ void SimpleTerminal::tswapscreen(void) {
 
     term.line = term.alt;
     term.alt = tmp;
+    int *blink = term.blink;
+    term.blink = term.altBlink;
+    term.altBlink = blink;
 
     int temp = term.scr;
     term.altScr = term.scr;
@@ -2128,6 +2207,17 @@ void SimpleTerminal::tsetmode(int priv, int set, const int *args, int narg) {
                 case 2004: /* 2004: bracketed paste mode */
                     xsetmode(set, MODE_BRCKTPASTE);
                     break;
+                case 2026: /* 2026: synchronized output */
+                    if (set) {
+                        /* a repeated begin does not extend the timeout */
+                        if (!IS_SET(term.mode, MODE_SYNC)) {
+                            syncTimer.start(syncTimeoutMs);
+                        }
+                        term.mode |= MODE_SYNC;
+                    } else {
+                        endSync();
+                    }
+                    break;
                     /* Not implemented mouse modes. See comments there. */
                 case 1001: /* mouse highlight mode; can hang the
                       terminal by design when implemented. */
@@ -2166,6 +2256,58 @@ void SimpleTerminal::tsetmode(int priv, int set, const int *args, int narg) {
     }
 }
 
+/*
+ * DECRQM state of a mode: 1 set, 2 reset, 0 not recognized
+ */
+int SimpleTerminal::tmodestate(int priv, int mode) {
+    int set;
+
+    if (priv) {
+        switch (mode) {
+            case 1: set = IS_SET(win.mode, MODE_APPCURSOR); break;
+            case 5: set = IS_SET(win.mode, MODE_REVERSE); break;
+            case 6: set = term.c.state & CURSOR_ORIGIN; break;
+            case 7: set = IS_SET(term.mode, MODE_WRAP); break;
+            case 9: set = IS_SET(win.mode, MODE_MOUSEX10); break;
+            case 25: set = !IS_SET(win.mode, MODE_HIDE); break;
+            case 47:
+            case 1047:
+            case 1049: set = IS_SET(term.mode, MODE_ALTSCREEN); break;
+            case 1000: set = IS_SET(win.mode, MODE_MOUSEBTN); break;
+            case 1002: set = IS_SET(win.mode, MODE_MOUSEMOTION); break;
+            case 1003: set = IS_SET(win.mode, MODE_MOUSEMANY); break;
+            case 1004: set = IS_SET(win.mode, MODE_FOCUS); break;
+            case 1006: set = IS_SET(win.mode, MODE_MOUSESGR); break;
+            case 1034: set = IS_SET(win.mode, MODE_8BIT); break;
+            case 2004: set = IS_SET(win.mode, MODE_BRCKTPASTE); break;
+            case 2026: set = IS_SET(term.mode, MODE_SYNC); break;
+            default: return 0;
+        }
+    } else {
+        switch (mode) {
+            case 2: set = IS_SET(win.mode, MODE_KBDLOCK); break;
+            case 4: set = IS_SET(term.mode, MODE_INSERT); break;
+            case 12: set = !IS_SET(term.mode, MODE_ECHO); break;
+            case 20: set = IS_SET(term.mode, MODE_CRLF); break;
+            default: return 0;
+        }
+    }
+    return set ? 1 : 2;
+}
+
+/*
+ * Finishes a synchronized update (or gives up waiting for it) and shows everything drawn meanwhile
+ */
+void SimpleTerminal::endSync() {
+    syncTimer.stop();
+    if (!IS_SET(term.mode, MODE_SYNC)) {
+        return;
+    }
+
+    term.mode &= ~MODE_SYNC;
+    emitDamage();
+}
+
 void SimpleTerminal::xsetmode(int set, unsigned int flags) {
     int mode = win.mode;
     MODBIT(win.mode, set, flags);
@@ -2173,24 +2315,303 @@ void SimpleTerminal::xsetmode(int set, unsigned int flags) {
         redraw();
 }
 
+void SimpleTerminal::setVisible(bool visible) {
+    if (visible == isVisible()) {
+        return;
+    }
+
+    xsetmode(visible, MODE_VISIBLE);
+    if (visible) {
+        // the output parsed meanwhile was never painted
+        unpaintedBytes = 0;
+        emitDamage();
+    }
+    checkBackpressure();
+}
+
 void SimpleTerminal::bell() {
-    QApplication::beep();
+    emit s_bell();
 }
 
 void SimpleTerminal::ttyresize(int tw, int th) {
     win.tw = tw;
     win.th = th;
 
-    wsize.ws_row = term.row;
-    wsize.ws_col = term.col;
-    wsize.ws_xpixel = tw;
-    wsize.ws_ypixel = th;
+    transport->resize(term.col, term.row, tw, th);
+}
+
+/*
+ * Enables measuring the parse time, all other counters are always collected
+ */
+void SimpleTerminal::setStatsEnabled(bool enabled) {
+    statsEnabled = enabled;
+}
+
+void SimpleTerminal::setParseBudget(int bytes, int microseconds) {
+    parseBudgetBytes = MAX(0, bytes);
+    parseBudgetUs = MAX(0, microseconds);
+
+    if (sliced()) {
+        // bytes kept by ttyread go first
+        pendingInput.prepend(readBuf, readBufPos);
+        readBufPos = 0;
+        parseSlice();
+    } else if (!pendingInput.isEmpty()) {
+        sliceTimer.stop();
+        feed(pendingInput.constData(), pendingInput.size());
+        pendingInput.clear();
+        slicePending = false;
+        updateReading();
+    }
+}
+
+/*
+ * Parses pending input until the byte or time budget is used up
+ * The rest is parsed in the next event loop turn, reading waits until everything is parsed.
+ */
+void SimpleTerminal::parseSlice() {
+    TraceScope trace("parseSlice");
+    char chunk[4096];
+    QElapsedTimer clock;
+    int offset = 0, written = 0;
+    bool budgetUsed = false;
+
+    /* replies written while parsing may read more input, it is appended and parsed by this loop */
+    if (parsing) {
+        return;
+    }
+    parsing = true;
+    clock.start();
+
+    while (offset < pendingInput.size() && !budgetUsed) {
+        int n = MIN((int) sizeof(chunk), pendingInput.size() - offset);
+        if (parseBudgetBytes > 0) {
+            /* a UTF-8 sequence crossing the budget is completed, so every chunk makes progress */
+            n = MIN(n, MAX(parseBudgetBytes - offset, UTF_SIZ));
+        }
+
+        /* pendingInput may grow (and move) during twrite */
+        ::memcpy(chunk, pendingInput.constData() + offset, n);
+        written = twrite(chunk, n, 0);
+        offset += written;
 
-    if (ioctl(master, TIOCSWINSZ, &wsize) < 0) {
-        emit s_error("Couldn't set window size: " + QString(strerror(errno)));
+        /* only an incomplete UTF-8 sequence at the end of the input is left, it waits for more input */
+        if (written == 0) {
+            break;
+        }
+
+        budgetUsed = (parseBudgetBytes > 0 && offset >= parseBudgetBytes)
+                     || (parseBudgetUs > 0 && clock.nsecsElapsed() >= parseBudgetUs * 1000LL);
+    }
+
+    if (statsEnabled) {
+        stats.parseNs += clock.nsecsElapsed();
+    }
+
+    parsing = false;
+    pendingInput.remove(0, offset);
+    unpaintedBytes += offset;
+
+    slicePending = budgetUsed && !pendingInput.isEmpty();
+    if (slicePending) {
+        sliceTimer.start();
+    }
+
+    updateReading();
+    checkBackpressure();
+    emitDamage();
+}
+
+/*
+ * Reads only while neither backpressure nor unparsed slices hold reading back
+ */
+void SimpleTerminal::updateReading() {
+    bool enabled = !paused && !slicePending;
+
+    if (enabled != readingEnabled) {
+        readingEnabled = enabled;
+        transport->setReadEnabled(enabled);
     }
 }
 
+void SimpleTerminal::setBackpressure(const Backpressure &policy) {
+    backpressure = policy;
+    checkBackpressure();
+}
+
+void SimpleTerminal::markPainted() {
+    unpaintedBytes = 0;
+    checkBackpressure();
+}
+
+/*
+ * Pauses or resumes reading depending on the unparsed and unpainted output
+ */
+void SimpleTerminal::checkBackpressure() {
+    int64_t pending = transport->bytesAvailable() + readBufPos + pendingInput.size();
+    bool overPending = backpressure.maxPendingBytes > 0 && pending > backpressure.maxPendingBytes;
+    /* nothing gets painted while hidden or during a synchronized update, waiting for it would only delay it */
+    bool overUnpainted = backpressure.maxUnpaintedBytes > 0 && unpaintedBytes > backpressure.maxUnpaintedBytes
+                         && IS_SET(win.mode, MODE_VISIBLE) && !IS_SET(term.mode, MODE_SYNC);
+
+    if (overPending || overUnpainted) {
+        pauseReading();
+    } else {
+        resumeReading();
+    }
+}
+
+void SimpleTerminal::pauseReading() {
+    if (paused) {
+        return;
+    }
+
+    paused = true;
+    stats.readPauses++;
+    pauseClock.start();
+    pauseTimer.start(backpressure.maxPauseMs);
+    updateReading();
+}
+
+void SimpleTerminal::resumeReading() {
+    if (!paused) {
+        return;
+    }
+
+    paused = false;
+    stats.pausedNs += pauseClock.nsecsElapsed();
+    pauseTimer.stop();
+
+    // the limits apply again to output from now on
+    unpaintedBytes = 0;
+    updateReading();
+}
+
+void SimpleTerminal::feed(const char *buf, int size) {
+    int written;
+
+    /* keep the order with input that is still waiting for its slice */
+    if (sliced() && (size > 0 || !pendingInput.isEmpty())) {
+        pendingInput.append(buf, size);
+        parseSlice();
+        return;
+    }
+
+    /* complete a sequence left over from the previous chunk byte by byte */
+    while (readBufPos > 0 && size > 0) {
+        readBuf[readBufPos++] = *buf++;
+        size--;
+        written = twrite(readBuf, readBufPos, 0);
+        readBufPos -= written;
+        if (readBufPos > 0) {
+            ::memmove(readBuf, readBuf + written, readBufPos);
+        }
+    }
+
+    written = twrite(buf, size, 0);
+    if (written < size) {
+        readBufPos = size - written;
+        ::memcpy(readBuf, buf + written, readBufPos);
+    }
+
+    emitDamage();
+}
+
+Glyph SimpleTerminal::cell(int x, int y) const {
+    if (x < 0 || x >= term.col || y >= term.row || y <= -HISTSIZE) {
+        return Glyph{' ', 0, defaultfg, defaultbg};
+    }
+
+    if (y < 0) {
+        return term.hist[(y + term.histi + HISTSIZE + 1) % HISTSIZE][x];
+    }
+    return term.line[y][x];
+}
+
+QString SimpleTerminal::text(int y) const {
+    QString line;
+    int len = term.col;
+
+    while (len > 0 && cell(len - 1, y).u == ' ') {
+        len--;
+    }
+
+    for (int x = 0; x < len; x++) {
+        Glyph g = cell(x, y);
+        if (g.mode & ATTR_WDUMMY) {
+            continue;
+        }
+        char32_t u = g.u;
+        line += QString::fromUcs4(&u, 1);
+    }
+    return line;
+}
+
+void SimpleTerminal::clearDamage() {
+    for (int y = 0; y < term.row; y++) {
+        term.dirty[y] = 0;
+    }
+}
+
+void SimpleTerminal::emitDamage() {
+    int top = 0, bottom = term.row - 1;
+
+    /* the dirty lines keep accumulating until the synchronized update ends or the view is shown */
+    if (IS_SET(term.mode, MODE_SYNC) || !IS_SET(win.mode, MODE_VISIBLE)) {
+        return;
+    }
+
+    while (top <= bottom && !term.dirty[top]) {
+        top++;
+    }
+    while (bottom >= top && !term.dirty[bottom]) {
+        bottom--;
+    }
+
+    if (top <= bottom) {
+        emit s_damage(top, bottom);
+    }
+    emit s_updateView(&term);
+}
+
+bool SimpleTerminal::startRecording(const QString &path) {
+    stopRecording();
+
+    recordFile = new QFile(path);
+    if (!recordFile->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        emit s_error("Could not open recording file " + path + ".");
+        delete recordFile;
+        recordFile = nullptr;
+        return false;
+    }
+
+    recordStream.setDevice(recordFile);
+    recordStream << PtyReplay::magic << PtyReplay::version << (quint16) term.col << (quint16) term.row;
+    recordClock.start();
+    recordLastUs = 0;
+    return true;
+}
+
+void SimpleTerminal::stopRecording() {
+    if (!recordFile) {
+        return;
+    }
+
+    recordStream.setDevice(nullptr);
+    recordFile->close();
+    delete recordFile;
+    recordFile = nullptr;
+}
+
+/*
+ * Writes the type and the time since the previous record in microseconds
+ */
+void SimpleTerminal::recordHeader(quint8 type) {
+    qint64 now = recordClock.nsecsElapsed() / 1000;
+    recordStream << type << (quint64) (now - recordLastUs);
+    recordLastUs = now;
+}
+
 void SimpleTerminal::selstart(int col, int row, int snap) {
     selclear();
     sel.mode = SEL_EMPTY;
@@ -2269,8 +2690,9 @@ void SimpleTerminal::xloadcols() {
 }
 
 int SimpleTerminal::xsetcursor(int cursor) {
-    // TODO
-    // qDebug() << "xsetcursor";
+    if (!BETWEEN(cursor, 0, 6))
+        return 1;
+    win.cursor = cursor;
     return 0;
 }
 
@@ -4,26 +4,42 @@
 #include <QObject>
 #include <QString>
 #include <QSocketNotifier>
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QPoint>
+#include <QTimer>
 
 #include <sys/ioctl.h>
 
 #include "st-utils.h"
+#include "transport.h"
 
 class SimpleTerminal : public QObject {
     Q_OBJECT
 public:
     Term term;
     Selection sel;
+    TermStats stats;
 
+    /*
+     * Starts the user's shell on a new pty
+     */
     SimpleTerminal(QObject *parent = nullptr);
 
-    ~SimpleTerminal();
+    /*
+     * Starts the given command on a new pty
+     */
+    SimpleTerminal(const ShellCommand &command, QObject *parent = nullptr);
 
-    void tnew(int col, int row);
+    /*
+     * Talks to the given transport instead of a shell, takes ownership of it
+     */
+    SimpleTerminal(Transport *transport, QObject *parent = nullptr);
 
-    void ttynew();
+    ~SimpleTerminal();
 
-    void execsh();
+    void tnew(int col, int row);
 
     void closePty();
 
@@ -37,6 +53,8 @@ public:
 
     void ttywriteraw(const char *s, size_t n);
 
+    void ttydrain();
+
     void kscrollup(int n);
 
     void kscrolldown(int n);
@@ -57,6 +75,87 @@ public:
 
     void selscroll(int orig, int n);
 
+    void setStatsEnabled(bool enabled);
+
+    /*
+     * Pauses reading from the transport while too much output is unparsed or unpainted (disabled by default)
+     * A paused child blocks on the pty, which bounds memory and leaves time for input and painting.
+     */
+    void setBackpressure(const Backpressure &policy);
+
+    /*
+     * Tells the core that everything parsed so far was painted, resumes reading if it was paused
+     */
+    void markPainted();
+
+    bool readPaused() const { return paused; }
+
+    /*
+     * Splits parsing into slices of at most bytes or microseconds per event loop turn, 0 for no limit
+     * Input and paint events are handled between slices. Without any limit (default) each read is parsed at once.
+     */
+    void setParseBudget(int bytes, int microseconds);
+
+    /*
+     * Parses bytes as if they were read from the transport, incomplete UTF-8 sequences are kept for the next call
+     */
+    void feed(const char *buf, int size);
+
+    int columns() const { return term.col; }
+
+    int rows() const { return term.row; }
+
+    /*
+     * Cell at column x of screen row y, negative rows read the history (up to HISTSIZE - 1 lines)
+     * Returns an empty cell outside of the screen.
+     */
+    Glyph cell(int x, int y) const;
+
+    /*
+     * Text of screen row y without trailing blanks, negative rows read the history
+     */
+    QString text(int y) const;
+
+    QPoint cursor() const { return QPoint(term.c.x, term.c.y); }
+
+    bool cursorVisible() const { return !(win.mode & MODE_HIDE); }
+
+    /*
+     * DECSCUSR cursor style: 0/1 blinking block, 2 steady block, 3 blinking underline, 4 steady underline,
+     * 5 blinking bar, 6 steady bar
+     */
+    int cursorStyle() const { return win.cursor; }
+
+    int termMode() const { return term.mode; } // term_mode flags
+
+    int windowMode() const { return win.mode; } // win_mode flags
+
+    /*
+     * While not visible the output is parsed only, s_updateView is emitted once it becomes visible again
+     */
+    void setVisible(bool visible);
+
+    bool isVisible() const { return win.mode & MODE_VISIBLE; }
+
+    /*
+     * Blinking text (ATTR_BLINK), the number of blinking cells is kept for every screen line
+     */
+    int blinkCount(int y) const { return term.blink[y]; }
+
+    bool blinking() const;
+
+    /*
+     * Resets the dirty flags, consumers that do not render call this after handling s_damage
+     */
+    void clearDamage();
+
+    /*
+     * Records every chunk read from the tty and every resize with its time to path (see PtyReplay)
+     */
+    bool startRecording(const QString &path);
+
+    void stopRecording();
+
 public
     slots:
             size_t ttyread();
@@ -68,18 +167,42 @@ public
 
     void s_updateView(Term *state);
 
-private:
-    TermWindow win;
-    winsize wsize;
+    void s_damage(int top, int bottom); // range of dirty screen rows after new input
+
+    void s_bell();
 
-    int master, slave;
-    pid_t processId;
+private:
+    TermWindow win{0, 0, 0, 0, 0, 0, MODE_VISIBLE, 0};
+    Transport *transport = nullptr;
 
     char readBuf[BUFSIZ];
     int readBufPos = 0;
     int readBufSize = 0;
 
-    QSocketNotifier *readNotifier;
+    bool statsEnabled = false;
+
+    Backpressure backpressure{0, 0, 100};
+    bool paused = false;
+    bool readingEnabled = true;
+    int64_t unpaintedBytes = 0;
+    QTimer pauseTimer;
+    QElapsedTimer pauseClock;
+
+    int parseBudgetBytes = 0;
+    int parseBudgetUs = 0;
+    QByteArray pendingInput; // read but not parsed yet while parsing in slices
+    bool slicePending = false;
+    bool parsing = false;
+    QTimer sliceTimer;
+
+    const int syncTimeoutMs = 150;
+    QTimer syncTimer;
+
+    QFile *recordFile = nullptr;
+    QDataStream recordStream;
+    QElapsedTimer recordClock;
+    qint64 recordLastUs = 0;
+
     CSIEscape csiescseq;
     STREscape strescseq;
 
@@ -140,6 +263,8 @@ private:
 
     void tsetchar(Rune u, const Glyph *attr, int x, int y);
 
+    int tcountblink(const Glyph *line) const;
+
     void csireset(void);
 
     void csiparse(void);
@@ -206,6 +331,10 @@ private:
 
     void tsetmode(int priv, int set, const int *args, int narg);
 
+    int tmodestate(int priv, int mode);
+
+    void endSync();
+
     void tswapscreen(void);
 
     void bell(void);
@@ -224,6 +353,26 @@ private:
     int xsetcursor(int cursor);
 
     void tprinter(char *s, size_t len); // TODO
+
+    void setTransport(Transport *transport);
+
+    size_t ttyreadlimit(size_t lim);
+
+    void emitDamage();
+
+    void checkBackpressure();
+
+    void pauseReading();
+
+    void resumeReading();
+
+    void updateReading();
+
+    void parseSlice();
+
+    bool sliced() const { return parseBudgetBytes > 0 || parseBudgetUs > 0; }
+
+    void recordHeader(quint8 type);
 };
 
 #endif // ST_H
@@ -0,0 +1,185 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#include "trace.h"
+
+#include <QFile>
+#include <QThread>
+#include <QByteArray>
+#include <QCoreApplication>
+
+#include <chrono>
+#include <string.h>
+
+std::atomic<bool> Trace::active{false};
+
+namespace {
+    const uint64_t capacity = 1 << 16; // must be a power of two
+
+    typedef struct {
+        std::atomic<uint64_t> seq; // index + 1 once the slot is filled
+        const char *name;
+        uint64_t start;
+        uint64_t end;
+        int tid;
+        uint8_t argLen;
+        char arg[32];
+    } TraceEvent;
+
+    TraceEvent *ring = nullptr; // allocated on the first start and kept, producers may still hold slots
+    std::atomic<uint64_t> head{0}; // next slot to reserve
+    std::atomic<uint64_t> tail{0}; // next slot to write out
+    std::atomic<uint64_t> droppedEvents{0};
+    std::atomic<int> nextTid{0};
+    thread_local int threadId = ++nextTid;
+
+    QFile traceFile;
+    QThread *writer = nullptr;
+    std::atomic<bool> writerRunning{false};
+    bool firstEvent = true;
+
+    void appendEscaped(QByteArray &out, const char *s, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            unsigned char c = s[i];
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += (char) c;
+            } else if (c < 0x20 || c >= 0x7f) {
+                out += QByteArray("\\u00") + QByteArray::number(c, 16).rightJustified(2, '0');
+            } else {
+                out += (char) c;
+            }
+        }
+    }
+
+    /*
+     * Writes all filled slots to the trace file, runs on the writer thread
+     */
+    void drain() {
+        static const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+        QByteArray out;
+        uint64_t t = tail.load(std::memory_order_relaxed);
+
+        for (;;) {
+            TraceEvent &e = ring[t & (capacity - 1)];
+            if (e.seq.load(std::memory_order_acquire) != t + 1) {
+                break;
+            }
+
+            out += firstEvent ? "\n" : ",\n";
+            firstEvent = false;
+            out += "{\"name\":\"";
+            out += e.name;
+            out += "\",\"ph\":\"X\",\"pid\":";
+            out += pid;
+            out += ",\"tid\":";
+            out += QByteArray::number(e.tid);
+            out += ",\"ts\":";
+            out += QByteArray::number(e.start / 1000.0, 'f', 3);
+            out += ",\"dur\":";
+            out += QByteArray::number((e.end - e.start) / 1000.0, 'f', 3);
+            if (e.argLen) {
+                out += ",\"args\":{\"seq\":\"";
+                appendEscaped(out, e.arg, e.argLen);
+                out += "\"}";
+            }
+            out += "}";
+
+            // release the slot for the producers
+            tail.store(++t, std::memory_order_release);
+        }
+
+        if (!out.isEmpty()) {
+            traceFile.write(out);
+        }
+    }
+}
+
+TraceScope::TraceScope(const char *name, const char *s, size_t len) : name(name) {
+    start = Trace::enabled() ? Trace::now() : 0;
+
+    if (start && s) {
+        argLen = len < sizeof(arg) ? len : sizeof(arg);
+        memcpy(arg, s, argLen);
+    }
+}
+
+bool Trace::start(const QString &path) {
+    if (enabled() || writer) {
+        return false;
+    }
+
+    if (!ring) {
+        ring = new TraceEvent[capacity]();
+    }
+
+    traceFile.setFileName(path);
+    if (!traceFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    traceFile.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    firstEvent = true;
+
+    writerRunning = true;
+    writer = QThread::create([]() {
+        while (writerRunning.load()) {
+            drain();
+            QThread::msleep(50);
+        }
+        drain();
+        traceFile.write("\n]}\n");
+        traceFile.close();
+    });
+    writer->start(QThread::LowPriority);
+
+    active = true;
+    return true;
+}
+
+void Trace::stop() {
+    if (!writer) {
+        return;
+    }
+
+    active = false;
+    writerRunning = false;
+    writer->wait();
+    delete writer;
+    writer = nullptr;
+}
+
+uint64_t Trace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Trace::complete(const char *name, uint64_t start, uint64_t end, const char *arg, size_t argLen) {
+    if (!ring) {
+        return;
+    }
+
+    // reserve a slot, drop the event if the writer fell a full ring behind
+    uint64_t idx = head.load(std::memory_order_relaxed);
+    do {
+        if (idx - tail.load(std::memory_order_acquire) >= capacity) {
+            droppedEvents.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    } while (!head.compare_exchange_weak(idx, idx + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+    TraceEvent &e = ring[idx & (capacity - 1)];
+    e.name = name;
+    e.start = start;
+    e.end = end;
+    e.tid = threadId;
+    e.argLen = arg ? (uint8_t) (argLen < sizeof(e.arg) ? argLen : sizeof(e.arg)) : 0;
+    if (e.argLen) {
+        memcpy(e.arg, arg, e.argLen);
+    }
+    e.seq.store(idx + 1, std::memory_order_release);
+}
+
+uint64_t Trace::dropped() {
+    return droppedEvents.load(std::memory_order_relaxed);
+}
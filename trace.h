@@ -0,0 +1,62 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Chrome/Perfetto trace-event recorder
+ * Events are recorded into a lock-free in-memory ring and written to the trace file by a background thread,
+ * so recording only costs a few atomic operations on the hot path. If the ring is full, events are dropped.
+ * The resulting file can be opened in chrome://tracing or https://ui.perfetto.dev.
+ */
+class Trace {
+public:
+    static bool start(const QString &path);
+
+    static void stop();
+
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+
+    static uint64_t now(); // monotonic time in ns
+
+    static void complete(const char *name, uint64_t start, uint64_t end, const char *arg = nullptr,
+                         size_t argLen = 0);
+
+    static uint64_t dropped(); // events dropped because the ring was full
+
+private:
+    static std::atomic<bool> active;
+};
+
+/*
+ * Records the lifetime of the scope as a complete event
+ * The optional argument (e.g. the escape sequence being handled) is copied when the scope starts.
+ */
+class TraceScope {
+public:
+    explicit TraceScope(const char *name) : name(name), start(Trace::enabled() ? Trace::now() : 0) {}
+
+    TraceScope(const char *name, const char *arg, size_t len);
+
+    ~TraceScope() {
+        if (start) {
+            Trace::complete(name, start, Trace::now(), arg, argLen);
+        }
+    }
+
+private:
+    const char *name;
+    uint64_t start; // 0 if tracing was disabled
+    char arg[32];
+    size_t argLen = 0;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,546 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#include "transport.h"
+#include "iomultiplexer.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <spawn.h>
+#include <signal.h>
+
+#include <QElapsedTimer>
+#include <QProcessEnvironment>
+#include <QVector>
+
+extern char **environ;
+
+#if   defined(__linux)
+#include <pty.h>
+#elif defined(__OpenBSD__) || defined(__NetBSD__) || defined(__APPLE__)
+#include <util.h>
+#elif defined(__FreeBSD__) || defined(__DragonFly__)
+#include <libutil.h>
+#endif
+
+FdTransport::FdTransport(QObject *parent) : Transport(parent) {
+    if (IoMultiplexer::usedByDefault()) {
+        multiplexer = IoMultiplexer::instance();
+    }
+}
+
+FdTransport::FdTransport(int readFd, int writeFd, bool ownsFds, IoMultiplexer *multiplexer, QObject *parent)
+        : FdTransport(parent) {
+    if (multiplexer) {
+        this->multiplexer = multiplexer;
+    }
+    attach(readFd, writeFd, ownsFds);
+}
+
+FdTransport::~FdTransport() {
+    if (readNotifier) {
+        readNotifier->setEnabled(false);
+    }
+
+    if (multiplexer && readFd > -1) {
+        multiplexer->remove(this);
+    }
+
+    if (ownsFds) {
+        if (writeFd > -1 && writeFd != readFd) {
+            ::close(writeFd);
+        }
+        if (readFd > -1) {
+            ::close(readFd);
+        }
+    }
+}
+
+void FdTransport::attach(int readFd, int writeFd, bool ownsFds) {
+    this->readFd = readFd;
+    this->writeFd = writeFd < 0 ? readFd : writeFd;
+    this->ownsFds = ownsFds;
+
+    if (multiplexer) {
+        // the multiplexer thread must never block on a read
+        ::fcntl(readFd, F_SETFL, ::fcntl(readFd, F_GETFL) | O_NONBLOCK);
+        multiplexer->add(this);
+        return;
+    }
+
+    readNotifier = new QSocketNotifier(readFd, QSocketNotifier::Read, this);
+    connect(readNotifier, &QSocketNotifier::activated, this, &Transport::s_readyRead);
+}
+
+void FdTransport::setMultiplexer(IoMultiplexer *multiplexer) {
+    if (readFd < 0) {
+        this->multiplexer = multiplexer;
+    }
+}
+
+qint64 FdTransport::read(char *buf, qint64 size) {
+    if (readFd < 0) {
+        return -1;
+    }
+
+    QMutexLocker locker(multiplexer ? &bufferLock : nullptr);
+
+    if (multiplexer && !buffer.isEmpty()) {
+        qint64 n = qMin<qint64>(size, buffer.size());
+        memcpy(buf, buffer.constData(), n);
+        buffer.remove(0, n);
+
+        if (!armed && readEnabled && !atEnd && buffer.size() < maxBuffered / 2) {
+            armed = true;
+            multiplexer->arm(this, true);
+        }
+        return n;
+    }
+
+    if (atEnd) {
+        closeLater();
+        return 0;
+    }
+
+    // nothing buffered, the lock keeps the order with the multiplexer thread
+    ssize_t ret = ::read(readFd, buf, size);
+
+    if (ret < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return 0;
+    }
+
+    // end of file for pipes and sockets, EIO for a pty whose shell exited
+    if (ret == 0 || (ret < 0 && errno == EIO)) {
+        atEnd = true;
+        closeLater();
+        return 0;
+    }
+    return ret;
+}
+
+/*
+ * Called from read, the reader may still use the transport, so closing and s_closed wait for the event loop
+ */
+void FdTransport::closeLater() {
+    if (readNotifier) {
+        readNotifier->setEnabled(false);
+    }
+
+    if (!closePending) {
+        closePending = true;
+        QMetaObject::invokeMethod(this, &FdTransport::close, Qt::QueuedConnection);
+    }
+}
+
+qint64 FdTransport::write(const char *buf, qint64 size) {
+    if (writeFd < 0) {
+        return -1;
+    }
+
+    ssize_t ret = ::write(writeFd, buf, size);
+
+    if (ret < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return 0;
+    }
+    return ret;
+}
+
+qint64 FdTransport::bytesAvailable() const {
+    QMutexLocker locker(&bufferLock);
+    return buffer.size();
+}
+
+void FdTransport::setReadEnabled(bool enabled) {
+    if (readNotifier) {
+        readNotifier->setEnabled(enabled);
+    }
+
+    if (!multiplexer || readFd < 0) {
+        readEnabled = enabled;
+        return;
+    }
+
+    QMutexLocker locker(&bufferLock);
+    readEnabled = enabled;
+
+    if (enabled && !armed && !atEnd && buffer.size() < maxBuffered) {
+        armed = true;
+        multiplexer->arm(this, true);
+    }
+
+    // hand over what was buffered while reading was paused
+    if (enabled && !notifyPending && (!buffer.isEmpty() || atEnd)) {
+        notifyPending = true;
+        QMetaObject::invokeMethod(this, &FdTransport::deliver, Qt::QueuedConnection);
+    }
+}
+
+/*
+ * Reads one budget from the descriptor into the buffer, runs on the multiplexer thread
+ */
+void FdTransport::fill(int budget) {
+    QMutexLocker locker(&bufferLock);
+
+    if (readEnabled && !atEnd && buffer.size() < maxBuffered) {
+        qsizetype old = buffer.size();
+        buffer.resize(old + budget);
+        ssize_t ret = ::read(readFd, buffer.data() + old, budget);
+        buffer.resize(old + qMax<ssize_t>(ret, 0));
+
+        if (ret == 0 || (ret < 0 && errno != EAGAIN && errno != EINTR)) {
+            atEnd = true;
+        }
+
+        // one notification per batch, deliver drains everything read until then
+        if (!notifyPending && (ret > 0 || atEnd)) {
+            notifyPending = true;
+            QMetaObject::invokeMethod(this, &FdTransport::deliver, Qt::QueuedConnection);
+        }
+    }
+
+    if (!readEnabled || atEnd || buffer.size() >= maxBuffered) {
+        armed = false;
+        multiplexer->arm(this, false);
+    }
+}
+
+/*
+ * Lets the reader drain the buffer, runs on the thread of the transport
+ */
+void FdTransport::deliver() {
+    qint64 before, after;
+
+    if (readFd < 0) {
+        return;
+    }
+
+    {
+        QMutexLocker locker(&bufferLock);
+        notifyPending = false;
+        after = buffer.size();
+    }
+
+    do {
+        before = after;
+        emit s_readyRead();
+
+        QMutexLocker locker(&bufferLock);
+        after = buffer.size();
+    } while (after > 0 && after < before && readEnabled);
+}
+
+void FdTransport::close() {
+    if (readFd < 0) {
+        return;
+    }
+
+    if (multiplexer) {
+        multiplexer->remove(this);
+
+        QMutexLocker locker(&bufferLock);
+        buffer.clear();
+        atEnd = true;
+    }
+
+    if (readNotifier) {
+        readNotifier->setEnabled(false);
+        readNotifier->deleteLater();
+        readNotifier = nullptr;
+    }
+
+    if (ownsFds) {
+        if (writeFd > -1 && writeFd != readFd) {
+            ::close(writeFd);
+        }
+        if (readFd > -1) {
+            ::close(readFd);
+        }
+    }
+
+    readFd = -1;
+    writeFd = -1;
+    emit s_closed();
+}
+
+PtyTransport::PtyTransport(QObject *parent) : FdTransport(parent) {}
+
+PtyTransport::Spawned PtyTransport::spawn(const ShellCommand &command, const struct winsize &size) {
+    Spawned spawned{-1, -1, 0, QString()};
+    struct winsize wsize = size;
+    QElapsedTimer spawnTimer;
+    spawnTimer.start();
+
+    int master = -1, slave = -1;
+    char slaveName[128];
+
+    /* seems to work fine on linux, openbsd and freebsd */
+    if (::openpty(&master, &slave, NULL, NULL, &wsize) < 0) {
+        spawned.error = "Could not open new file descriptor.";
+        return spawned;
+    }
+
+    // neither end may leak into the shell, it opens the slave by name
+    ::fcntl(master, F_SETFD, FD_CLOEXEC);
+    ::fcntl(slave, F_SETFD, FD_CLOEXEC);
+
+    if (::ttyname_r(slave, slaveName, sizeof(slaveName)) != 0) {
+        ::close(master);
+        ::close(slave);
+        spawned.error = "Could not resolve the pty name.";
+        return spawned;
+    }
+
+    // everything is prepared before the child exists, it only opens the tty and executes
+    QList<QByteArray> argStore, envStore;
+    QByteArray program = prepare(command, argStore, envStore);
+
+    QVector<char *> argv, envp;
+    for (QByteArray &arg: argStore) {
+        argv.append(arg.data());
+    }
+    argv.append(nullptr);
+    for (QByteArray &env: envStore) {
+        envp.append(env.data());
+    }
+    envp.append(nullptr);
+
+#if defined(__linux__) && defined(POSIX_SPAWN_SETSID)
+    /*
+     * posix_spawn does not copy the page tables of the (possibly large) host process.
+     * On Linux a session leader without a controlling tty acquires the first tty it opens, so opening the slave on
+     * fd 0 makes it the controlling tty. The BSDs and macOS need TIOCSCTTY, so they keep the fork path below.
+     */
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t attr;
+    sigset_t mask, defaults;
+
+    ::posix_spawn_file_actions_init(&actions);
+    ::posix_spawn_file_actions_addopen(&actions, 0, slaveName, O_RDWR, 0);
+    ::posix_spawn_file_actions_adddup2(&actions, 0, 1);
+    ::posix_spawn_file_actions_adddup2(&actions, 0, 2);
+
+    ::sigemptyset(&mask);
+    ::sigfillset(&defaults);
+    ::sigdelset(&defaults, SIGKILL);
+    ::sigdelset(&defaults, SIGSTOP);
+
+    ::posix_spawnattr_init(&attr);
+    ::posix_spawnattr_setsigmask(&attr, &mask);
+    ::posix_spawnattr_setsigdefault(&attr, &defaults);
+    ::posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID | POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    int err = ::posix_spawnp(&spawned.pid, program.constData(), &actions, &attr, argv.data(), envp.data());
+
+    ::posix_spawnattr_destroy(&attr);
+    ::posix_spawn_file_actions_destroy(&actions);
+
+    if (err != 0) {
+        ::close(master);
+        ::close(slave);
+        spawned.pid = -1;
+        spawned.error = "Could not spawn " + QString(program) + ": " + QString(strerror(err));
+        return spawned;
+    }
+#else
+    switch (spawned.pid = fork()) {
+        case -1:
+            ::close(master);
+            ::close(slave);
+            spawned.error = "Could not fork process.";
+            return spawned;
+        case 0:
+            ::close(master);
+            ::setsid(); /* create a new process group */
+            ::dup2(slave, 0);
+            ::dup2(slave, 1);
+            ::dup2(slave, 2);
+            if (::ioctl(slave, TIOCSCTTY, NULL) < 0) {
+                ::_exit(1);
+            }
+            if (slave > 2)
+                ::close(slave);
+#ifdef __OpenBSD__
+            if (::pledge("stdio getpw proc exec", NULL) == -1){
+                ::_exit(1);
+            }
+#endif
+            environ = envp.data();
+            ::execvp(program.constData(), argv.data());
+            ::_exit(1);
+        default:
+#ifdef __OpenBSD__
+            if (::pledge("stdio rpath tty proc", NULL) == -1){
+                ::close(master);
+                ::close(slave);
+                spawned.error = "Error on pledge.";
+                return spawned;
+            }
+#endif
+            break;
+    }
+#endif
+
+    ::close(slave);
+    spawned.master = master;
+    spawned.spawnNs = spawnTimer.nsecsElapsed();
+    return spawned;
+}
+
+bool PtyTransport::open(const ShellCommand &command) {
+    Spawned spawned = spawn(command, initialSize);
+
+    if (spawned.master < 0) {
+        emit s_error(spawned.error);
+        return false;
+    }
+
+    adopt(spawned);
+    return true;
+}
+
+void PtyTransport::adopt(const Spawned &spawned) {
+    processId = spawned.pid;
+    spawnTime = spawned.spawnNs;
+    attach(spawned.master, spawned.master, true);
+}
+
+/*
+ * Resolves the program and builds the arguments and environment of the shell
+ */
+QByteArray PtyTransport::prepare(const ShellCommand &command, QList<QByteArray> &args, QList<QByteArray> &env) {
+    // reentrant lookup, the shell pool prepares shells on a worker thread
+    struct passwd entry, *pw = nullptr;
+    char entryBuf[4096];
+    ::getpwuid_r(getuid(), &entry, entryBuf, sizeof(entryBuf), &pw);
+
+    QByteArray program = command.program.toLocal8Bit();
+    if (program.isEmpty()) {
+        program = qgetenv("SHELL");
+    }
+    if (program.isEmpty()) {
+        program = (pw && pw->pw_shell[0]) ? pw->pw_shell : "/bin/sh";
+    }
+
+    args.append(program);
+    for (const QString &arg: command.arguments) {
+        args.append(arg.toLocal8Bit());
+    }
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.remove("COLUMNS");
+    environment.remove("LINES");
+    environment.remove("TERMCAP");
+    if (pw) {
+        environment.insert("LOGNAME", pw->pw_name);
+        environment.insert("USER", pw->pw_name);
+        environment.insert("HOME", pw->pw_dir);
+    }
+    environment.insert("SHELL", program);
+    // TODO figure out a way to use tic command with custom term info file
+    environment.insert("TERM", "xterm-256color");
+
+    for (const QString &entry: command.environment) {
+        int split = entry.indexOf('=');
+        if (split > 0) {
+            environment.insert(entry.left(split), entry.mid(split + 1));
+        } else {
+            environment.remove(entry);
+        }
+    }
+
+    for (const QString &entry: environment.toStringList()) {
+        env.append(entry.toLocal8Bit());
+    }
+    return program;
+}
+
+void PtyTransport::setInitialSize(int cols, int rows, int width, int height) {
+    initialSize.ws_row = rows;
+    initialSize.ws_col = cols;
+    initialSize.ws_xpixel = width;
+    initialSize.ws_ypixel = height;
+}
+
+void PtyTransport::resize(int cols, int rows, int width, int height) {
+    struct winsize wsize;
+
+    wsize.ws_row = rows;
+    wsize.ws_col = cols;
+    wsize.ws_xpixel = width;
+    wsize.ws_ypixel = height;
+
+    if (writeFd > -1 && ::ioctl(writeFd, TIOCSWINSZ, &wsize) < 0) {
+        emit s_error("Couldn't set window size: " + QString(strerror(errno)));
+    }
+}
+
+void MemoryTransport::feed(const QByteArray &data) {
+    if (closed) {
+        return;
+    }
+
+    input.append(data);
+    drain();
+}
+
+QByteArray MemoryTransport::takeWritten() {
+    QByteArray data = written;
+    written.clear();
+    return data;
+}
+
+qint64 MemoryTransport::read(char *buf, qint64 size) {
+    if (closed) {
+        return 0;
+    }
+
+    qint64 n = qMin<qint64>(size, input.size());
+    memcpy(buf, input.constData(), n);
+    input.remove(0, n);
+    return n;
+}
+
+qint64 MemoryTransport::write(const char *buf, qint64 size) {
+    if (closed) {
+        return -1;
+    }
+
+    written.append(buf, size);
+    return size;
+}
+
+void MemoryTransport::setReadEnabled(bool enabled) {
+    readEnabled = enabled;
+    drain();
+}
+
+/*
+ * Notifies the reader until the input is consumed or the reader stops taking bytes
+ */
+void MemoryTransport::drain() {
+    qint64 before;
+
+    do {
+        before = input.size();
+        if (!readEnabled || closed || before == 0) {
+            return;
+        }
+        emit s_readyRead();
+    } while (input.size() < before);
+}
+
+void MemoryTransport::close() {
+    if (closed) {
+        return;
+    }
+
+    closed = true;
+    input.clear();
+    emit s_closed();
+}
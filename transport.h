@@ -0,0 +1,228 @@
+/*
+ *  Copyright© Florian Plesker <florian.plesker@web.de>
+ */
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QSocketNotifier>
+#include <QMutex>
+
+#include <sys/types.h>
+#include <sys/ioctl.h>
+
+#include <QStringList>
+#include <QList>
+
+class IoMultiplexer;
+
+/*
+ * Program started on a new pty
+ */
+typedef struct {
+    QString program;         // empty for $SHELL, the login shell or /bin/sh
+    QStringList arguments;
+    QStringList environment; // KEY=VALUE entries added to the environment, a bare KEY removes it
+} ShellCommand;
+
+/*
+ * Byte stream between the terminal core and the program it talks to
+ * SimpleTerminal reads when s_readyRead is emitted and writes its replies and the user input back.
+ */
+class Transport : public QObject {
+    Q_OBJECT
+public:
+    explicit Transport(QObject *parent = nullptr) : QObject(parent) {}
+
+    /*
+     * Reads up to size bytes, returns 0 if nothing is available or the stream ended and -1 if it failed
+     * The end of the stream is reported with s_closed.
+     */
+    virtual qint64 read(char *buf, qint64 size) = 0;
+
+    /*
+     * Writes up to size bytes, returns the number of bytes written or -1 on failure
+     */
+    virtual qint64 write(const char *buf, qint64 size) = 0;
+
+    /*
+     * File descriptor that becomes readable with new input, -1 if there is none to wait on
+     */
+    virtual int readDescriptor() const { return -1; }
+
+    /*
+     * File descriptor to wait on before writing, -1 if writing never blocks
+     */
+    virtual int writeDescriptor() const { return -1; }
+
+    /*
+     * Propagates the terminal size, only meaningful for pseudo terminals
+     */
+    virtual void resize(int, int, int, int) {}
+
+    /*
+     * Bytes already read from the source but not yet taken by read
+     */
+    virtual qint64 bytesAvailable() const { return 0; }
+
+    virtual void setReadEnabled(bool enabled) = 0;
+
+    virtual void close() = 0;
+
+    signals:
+            void s_readyRead();
+
+    void s_closed();
+
+    void s_error(QString);
+};
+
+/*
+ * Transport over existing file descriptors, e.g. a pipe pair, a socketpair or the pty of a process managed elsewhere
+ * If writeFd is -1 the read descriptor is used for both directions.
+ * The read descriptor is watched by a socket notifier on the owning thread or, if set, by a shared IoMultiplexer.
+ * Without a multiplexer the shared one is used if IoMultiplexer::usedByDefault is set.
+ */
+class FdTransport : public Transport {
+    Q_OBJECT
+public:
+    FdTransport(int readFd, int writeFd = -1, bool ownsFds = true, IoMultiplexer *multiplexer = nullptr,
+                QObject *parent = nullptr);
+
+    ~FdTransport();
+
+    qint64 read(char *buf, qint64 size) override;
+
+    qint64 write(const char *buf, qint64 size) override;
+
+    int readDescriptor() const override { return readFd; }
+
+    int writeDescriptor() const override { return writeFd; }
+
+    qint64 bytesAvailable() const override;
+
+    void setReadEnabled(bool enabled) override;
+
+    void close() override;
+
+    /*
+     * Reads through the given multiplexer instead of a socket notifier, only before the descriptors are attached
+     * (a PtyTransport before open), descriptors passed to the constructor are attached right away
+     */
+    void setMultiplexer(IoMultiplexer *multiplexer);
+
+protected:
+    explicit FdTransport(QObject *parent = nullptr);
+
+    void attach(int readFd, int writeFd, bool ownsFds);
+
+    void closeLater(); // the stream ended, closes once the reader returned
+
+    int readFd = -1;
+    int writeFd = -1;
+    bool ownsFds = true;
+    bool readEnabled = true;
+    QSocketNotifier *readNotifier = nullptr;
+
+private:
+    friend class IoMultiplexer;
+
+    static const int maxBuffered = 1 << 20; // the multiplexer pauses reading above this
+
+    // state shared with the multiplexer thread, guarded by bufferLock
+    IoMultiplexer *multiplexer = nullptr;
+    mutable QMutex bufferLock;
+    QByteArray buffer;
+    bool armed = true;
+    bool notifyPending = false;
+    bool atEnd = false;
+    bool closePending = false;
+
+    void fill(int budget);
+
+    void deliver();
+};
+
+/*
+ * Pseudo terminal running a shell
+ * On Linux the shell is started with posix_spawn in a new session, other systems fork to set the controlling tty.
+ */
+class PtyTransport : public FdTransport {
+    Q_OBJECT
+public:
+    explicit PtyTransport(QObject *parent = nullptr);
+
+    typedef struct {
+        int master;       // -1 if the spawn failed
+        pid_t pid;
+        qint64 spawnNs;
+        QString error;
+    } Spawned;
+
+    /*
+     * Opens a new pty and starts the command on it
+     */
+    bool open(const ShellCommand &command = ShellCommand());
+
+    /*
+     * Same as open without touching any QObject, so the pty can be prepared on a worker thread and adopted later
+     */
+    static Spawned spawn(const ShellCommand &command, const struct winsize &size);
+
+    void adopt(const Spawned &spawned); // takes over a shell started by spawn
+
+    void resize(int cols, int rows, int width, int height) override;
+
+    /*
+     * Size of the pty when it is opened, so the shell starts with the right dimensions
+     */
+    void setInitialSize(int cols, int rows, int width, int height);
+
+    pid_t pid() const { return processId; }
+
+    qint64 spawnNs() const { return spawnTime; } // time to open the pty and start the shell
+
+private:
+    pid_t processId = -1;
+    qint64 spawnTime = 0;
+    struct winsize initialSize = {24, 80, 0, 0};
+
+    static QByteArray prepare(const ShellCommand &command, QList<QByteArray> &args, QList<QByteArray> &env);
+};
+
+/*
+ * In-memory transport to drive the terminal without a process
+ * Bytes passed to feed are read by the terminal, everything the terminal writes is collected in written.
+ */
+class MemoryTransport : public Transport {
+    Q_OBJECT
+public:
+    explicit MemoryTransport(QObject *parent = nullptr) : Transport(parent) {}
+
+    void feed(const QByteArray &data);
+
+    QByteArray takeWritten();
+
+    qint64 read(char *buf, qint64 size) override;
+
+    qint64 write(const char *buf, qint64 size) override;
+
+    qint64 bytesAvailable() const override { return input.size(); }
+
+    void setReadEnabled(bool enabled) override;
+
+    void close() override;
+
+private:
+    QByteArray input;
+    QByteArray written;
+    bool readEnabled = true;
+    bool closed = false;
+
+    void drain();
+};
+
+#endif // TRANSPORT_H